@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "ahrs-filter.h"
+
+#define ATTITUDE_TAU 0.5f /*s, how long gyro integration is trusted*/
+#define TRACK_GAIN 0.3f /*share of the GPS/estimate gap corrected on each fix*/
+#define TRACK_MIN_SPEED 2.0f /*m/s, GPS track is meaningless below*/
+#define IMU_MAX_GAP 1.0f /*s, restart from the measurements after that*/
+
+/* Vertical filter tuning. Without an accelerometer the vertical
+ * acceleration is unknown and modeled as a larger process noise*/
+#define ACCEL_NOISE 0.5f /*m/s²*/
+#define MANEUVER_NOISE 1.0f /*m/s²*/
+#define GPS_ALT_NOISE 4.0f /*m*/
+#define VS_INITIAL_VAR 25.0f /*(m/s)²*/
+
+#define EARTH_RADIUS 6371000.0 /*m*/
+#define DEG2RAD (M_PI/180.0)
+
+static inline float wrap180(float a)
+{
+    a = fmodf(a + 180.0f, 360.0f);
+    if(a < 0) a += 360.0f;
+    return a - 180.0f;
+}
+
+static inline float wrap360(float a)
+{
+    a = fmodf(a, 360.0f);
+    return (a < 0) ? a + 360.0f : a;
+}
+
+AhrsFilter *ahrs_filter_init(AhrsFilter *self)
+{
+    memset(self, 0, sizeof(AhrsFilter));
+    self->latitude = self->longitude = NAN;
+    self->alt = NAN;
+    self->accel_z = NAN;
+    return self;
+}
+
+static void ahrs_filter_vertical_predict(AhrsFilter *self, uint64_t t)
+{
+    float dt, dt2, a, q;
+
+    if(t <= self->kf_t)
+        return;
+    dt = (t - self->kf_t) / 1e9f;
+    dt2 = dt * dt;
+    self->kf_t = t;
+
+    if(isnan(self->accel_z)){
+        a = 0;
+        q = MANEUVER_NOISE * MANEUVER_NOISE;
+    }else{
+        a = self->accel_z;
+        q = ACCEL_NOISE * ACCEL_NOISE;
+    }
+    self->alt += self->vs * dt + 0.5f * a * dt2;
+    self->vs += a * dt;
+
+    /*P = F.P.Ft + Q, F = [1 dt; 0 1]*/
+    self->P[0][0] += dt * (self->P[0][1] + self->P[1][0]) + dt2 * self->P[1][1] + q * dt2 * dt2 / 4;
+    self->P[0][1] += dt * self->P[1][1] + q * dt2 * dt / 2;
+    self->P[1][0] += dt * self->P[1][1] + q * dt2 * dt / 2;
+    self->P[1][1] += q * dt2;
+}
+
+static void ahrs_filter_vertical_update(AhrsFilter *self, float altitude)
+{
+    float y, s, k0, k1;
+    float p00, p01;
+
+    y = altitude - self->alt;
+    s = self->P[0][0] + GPS_ALT_NOISE * GPS_ALT_NOISE;
+    k0 = self->P[0][0] / s;
+    k1 = self->P[1][0] / s;
+
+    self->alt += k0 * y;
+    self->vs += k1 * y;
+
+    p00 = self->P[0][0];
+    p01 = self->P[0][1];
+    self->P[0][0] -= k0 * p00;
+    self->P[0][1] -= k0 * p01;
+    self->P[1][0] -= k1 * p00;
+    self->P[1][1] -= k1 * p01;
+}
+
+/**
+ * @brief Feeds an IMU sample. Samples must come in chronological order.
+ */
+void ahrs_filter_imu(AhrsFilter *self, const ImuSample *sample)
+{
+    float dt, alpha;
+    bool has_rates;
+
+    dt = self->has_imu ? (int64_t)(sample->t - self->imu_t) / 1e9f : 0;
+    if(self->has_imu && dt <= 0)
+        return;
+    self->imu_t = sample->t;
+
+    has_rates = !isnan(sample->gyro[0]) && !isnan(sample->gyro[1]) && !isnan(sample->gyro[2]);
+    if(!self->has_imu || !has_rates || dt > IMU_MAX_GAP){
+        if(!isnan(sample->roll)) self->roll = sample->roll;
+        if(!isnan(sample->pitch)) self->pitch = sample->pitch;
+        if(!isnan(sample->heading)) self->heading = wrap360(sample->heading);
+    }else{
+        /*Small angles: body rates taken as Euler angles rates*/
+        self->roll += sample->gyro[0] * dt;
+        self->pitch += sample->gyro[1] * dt;
+        self->heading += sample->gyro[2] * dt;
+
+        alpha = dt / (ATTITUDE_TAU + dt);
+        if(!isnan(sample->roll))
+            self->roll += alpha * wrap180(sample->roll - self->roll);
+        if(!isnan(sample->pitch))
+            self->pitch += alpha * (sample->pitch - self->pitch);
+        if(!isnan(sample->heading))
+            self->heading += alpha * wrap180(sample->heading - self->heading);
+        self->heading = wrap360(self->heading);
+    }
+
+    /*Between two fixes, the ground track turns with the aircraft*/
+    if(!isnan(sample->heading)){
+        if(self->has_imu && self->has_fix)
+            self->track = wrap360(self->track + wrap180(sample->heading - self->imu_heading));
+        self->imu_heading = sample->heading;
+    }
+    self->has_imu = true;
+
+    if(!self->has_fix)
+        return;
+
+    self->accel_z = sample->accel_z;
+    ahrs_filter_vertical_predict(self, sample->t);
+
+    if(self->speed > 0 && dt > 0 && dt <= IMU_MAX_GAP){
+        double d = self->speed * dt;
+        self->latitude += d * cos(self->track * DEG2RAD) / EARTH_RADIUS / DEG2RAD;
+        self->longitude += d * sin(self->track * DEG2RAD)
+                         / (EARTH_RADIUS * cos(self->latitude * DEG2RAD)) / DEG2RAD;
+    }
+}
+
+/**
+ * @brief Feeds a GPS fix. Speed and track are derived from the previous
+ * fix when the receiver doesn't give them.
+ */
+void ahrs_filter_gps(AhrsFilter *self, const GpsFix *fix)
+{
+    float speed, track;
+    float dt;
+
+    if(isnan(fix->latitude) || isnan(fix->longitude))
+        return;
+
+    if(!self->has_fix){
+        self->latitude = fix->latitude;
+        self->longitude = fix->longitude;
+        self->speed = isnan(fix->speed) ? 0 : fix->speed;
+        if(!isnan(fix->track))
+            self->track = wrap360(fix->track);
+        else
+            self->track = self->has_imu ? self->imu_heading : 0;
+
+        self->kf_t = fix->t;
+        self->alt = isnan(fix->altitude) ? 0 : fix->altitude;
+        self->vs = 0;
+        self->P[0][0] = GPS_ALT_NOISE * GPS_ALT_NOISE;
+        self->P[0][1] = self->P[1][0] = 0;
+        self->P[1][1] = VS_INITIAL_VAR;
+
+        self->fix = *fix;
+        self->has_fix = true;
+        return;
+    }
+
+    speed = fix->speed;
+    track = fix->track;
+    dt = (int64_t)(fix->t - self->fix.t) / 1e9f;
+    if((isnan(speed) || isnan(track)) && dt > 0){
+        /*Equirectangular approximation, fine between two fixes*/
+        double dn = (fix->latitude - self->fix.latitude) * DEG2RAD * EARTH_RADIUS;
+        double de = (fix->longitude - self->fix.longitude) * DEG2RAD * EARTH_RADIUS
+                   * cos(fix->latitude * DEG2RAD);
+        if(isnan(speed))
+            speed = sqrt(dn*dn + de*de) / dt;
+        if(isnan(track))
+            track = atan2(de, dn) / DEG2RAD;
+    }
+    if(!isnan(speed))
+        self->speed = speed;
+    if(!isnan(track) && self->speed >= TRACK_MIN_SPEED)
+        self->track = wrap360(self->track + TRACK_GAIN * wrap180(track - self->track));
+
+    /*Fixes win over dead reckoning*/
+    self->latitude = fix->latitude;
+    self->longitude = fix->longitude;
+
+    if(!isnan(fix->altitude)){
+        ahrs_filter_vertical_predict(self, fix->t);
+        ahrs_filter_vertical_update(self, fix->altitude);
+    }
+    self->fix = *fix;
+}
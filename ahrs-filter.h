@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef AHRS_FILTER_H
+#define AHRS_FILTER_H
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Fields that a sensor can't provide are NAN */
+typedef struct{
+    uint64_t t; /*ns, any monotonic clock*/
+    /*Absolute attitude, degrees*/
+    float roll, pitch, heading;
+    /*Body rates, degrees/s*/
+    float gyro[3];
+    /*Vertical acceleration in the earth frame, gravity removed, m/s²*/
+    float accel_z;
+}ImuSample;
+
+typedef struct{
+    uint64_t t; /*ns, same clock as ImuSample*/
+    double latitude, longitude; /*degrees*/
+    float altitude; /*m*/
+    float speed; /*ground speed, m/s*/
+    float track; /*degrees true*/
+}GpsFix;
+
+/* Fuses IMU samples (100-400Hz) and GPS fixes (1-10Hz):
+ * - attitude: gyro rates integration, pulled towards the absolute
+ *   attitude (complementary filter). Without gyro rates the absolute
+ *   attitude is used as is.
+ * - ground track: GPS track, propagated between fixes with the IMU
+ *   heading changes.
+ * - position: dead reckoning between fixes.
+ * - altitude and vertical speed: 2 states Kalman filter, GPS altitude
+ *   measurements, vertical acceleration (if any) as input.
+ */
+typedef struct{
+    bool has_imu;
+    bool has_fix;
+
+    uint64_t imu_t;
+    float roll, pitch, heading;
+    float imu_heading; /*last raw one*/
+
+    GpsFix fix; /*last one*/
+    double latitude, longitude;
+    float speed;
+    float track;
+
+    /*Vertical Kalman filter*/
+    uint64_t kf_t;
+    float alt, vs;
+    float P[2][2];
+    float accel_z;
+}AhrsFilter;
+
+AhrsFilter *ahrs_filter_init(AhrsFilter *self);
+
+void ahrs_filter_imu(AhrsFilter *self, const ImuSample *sample);
+void ahrs_filter_gps(AhrsFilter *self, const GpsFix *fix);
+#endif /* AHRS_FILTER_H */
@@ -16,6 +16,7 @@
 #include "misc.h"
 
 static BaseGaugeOps airspeed_indicator_ops = {
+   .name = "AirspeedIndicator",
    .render = (RenderFunc)NULL,
    .update_state = (StateUpdateFunc)NULL,
    .dispose = (DisposeFunc)NULL
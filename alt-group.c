@@ -17,6 +17,7 @@
 #include "res-dirs.h"
 
 static BaseGaugeOps alt_group_ops = {
+   .name = "AltGroup",
    .render = (RenderFunc)NULL,
    .update_state = (StateUpdateFunc)NULL,
    .dispose = (DisposeFunc)NULL
@@ -17,6 +17,7 @@
 #include "tape-gauge.h"
 
 static BaseGaugeOps alt_indicator_ops = {
+   .name = "AltIndicator",
    .render = (RenderFunc)NULL,
    .update_state = (StateUpdateFunc)NULL,
    .dispose = (DisposeFunc)NULL
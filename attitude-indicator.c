@@ -29,6 +29,7 @@ static void attitude_indicator_render(AttitudeIndicator *self, Uint32 dt, Render
 static void attitude_indicator_update_state(AttitudeIndicator *self, Uint32 dt);
 static void *attitude_indicator_dispose(AttitudeIndicator *self);
 static BaseGaugeOps attitude_indicator_ops = {
+   .name = "AttitudeIndicator",
    .render = (RenderFunc)attitude_indicator_render,
    .update_state = (StateUpdateFunc)attitude_indicator_update_state,
    .dispose = (DisposeFunc)attitude_indicator_dispose
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <math.h>
+
+#include "attitude-predictor.h"
+
+/*Brings an angle difference back into [-180, 180[*/
+static inline float angle_delta(float to, float from)
+{
+    float rv;
+
+    rv = fmodf(to - from + 180.0f, 360.0f);
+    if(rv < 0)
+        rv += 360.0f;
+    return rv - 180.0f;
+}
+
+/**
+ * @brief Sets up the predictor.
+ *
+ * @param horizon Maximum extrapolation past the last sample, ms
+ */
+AttitudePredictor *attitude_predictor_init(AttitudePredictor *self, uint32_t horizon)
+{
+    *self = (AttitudePredictor){
+        .horizon = horizon
+    };
+    return self;
+}
+
+/**
+ * @brief Feeds an actual sample to the predictor and updates the
+ * rate estimates.
+ *
+ * @param sample Must have its timestamp set
+ */
+void attitude_predictor_add_sample(AttitudePredictor *self, AttitudeData *sample)
+{
+    float dt;
+
+    if(!self->primed){
+        self->last = *sample;
+        self->primed = true;
+        return;
+    }
+
+    if(sample->timestamp <= self->last.timestamp)
+        return; /*Out of order or duplicate*/
+
+    dt = (sample->timestamp - self->last.timestamp) / 1000000000.0f;
+    if(dt * 1000 > PREDICTOR_MAX_GAP_MS){
+        self->roll_rate = self->pitch_rate = self->heading_rate = 0;
+    }else{
+        self->roll_rate += PREDICTOR_RATE_ALPHA
+            * (angle_delta(sample->roll, self->last.roll) / dt - self->roll_rate);
+        self->pitch_rate += PREDICTOR_RATE_ALPHA
+            * ((sample->pitch - self->last.pitch) / dt - self->pitch_rate);
+        self->heading_rate += PREDICTOR_RATE_ALPHA
+            * (angle_delta(sample->heading, self->last.heading) / dt - self->heading_rate);
+    }
+    self->last = *sample;
+}
+
+/**
+ * @brief Extrapolates the attitude at time @p at.
+ *
+ * @param at monotonic_ns() timestamp to predict the attitude at
+ * @param out Where to store the predicted attitude. Its timestamp is the
+ * one of the last actual sample.
+ * @return false if no prediction can be made yet (no sample)
+ */
+bool attitude_predictor_predict(AttitudePredictor *self, uint64_t at, AttitudeData *out)
+{
+    float dt;
+
+    if(!self->primed)
+        return false;
+
+    dt = 0;
+    if(at > self->last.timestamp)
+        dt = (at - self->last.timestamp) / 1000000000.0f;
+    if(dt * 1000 > self->horizon)
+        dt = self->horizon / 1000.0f;
+
+    *out = self->last;
+    out->roll = self->last.roll + self->roll_rate * dt;
+    out->roll = angle_delta(out->roll, 0);
+    out->pitch = self->last.pitch + self->pitch_rate * dt;
+    out->pitch = fmaxf(-90.0f, fminf(90.0f, out->pitch));
+    out->heading = fmodf(self->last.heading + self->heading_rate * dt, 360.0f);
+    if(out->heading < 0)
+        out->heading += 360.0f;
+    out->predicted = true;
+
+    return true;
+}
@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef ATTITUDE_PREDICTOR_H
+#define ATTITUDE_PREDICTOR_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data-source.h"
+
+/* Beyond that gap between two samples, rates are considered
+ * meaningless and reset*/
+#define PREDICTOR_MAX_GAP_MS 2000
+/*Weight of a new rate measurement, 1.0 means no smoothing at all*/
+#define PREDICTOR_RATE_ALPHA 0.5f
+
+/* Dead-reckoning of the attitude between two (slow) samples: estimates
+ * roll/pitch/heading rates from the last samples and extrapolates them
+ * up to the display time. Extrapolation is capped to @horizon ms past
+ * the last sample so that a source going silent doesn't make the
+ * horizon spin forever.
+ */
+typedef struct _AttitudePredictor{
+    uint32_t horizon; /*ms, 0 means disabled*/
+
+    AttitudeData last;  /*Last actual sample*/
+    bool primed;        /*At least one sample received*/
+    AttitudeData output; /*Last prediction handed to listeners*/
+
+    /*degrees per second*/
+    float roll_rate;
+    float pitch_rate;
+    float heading_rate;
+}AttitudePredictor;
+
+AttitudePredictor *attitude_predictor_init(AttitudePredictor *self, uint32_t horizon);
+void attitude_predictor_add_sample(AttitudePredictor *self, AttitudeData *sample);
+bool attitude_predictor_predict(AttitudePredictor *self, uint64_t at, AttitudeData *out);
+#endif /* ATTITUDE_PREDICTOR_H */
@@ -13,6 +13,7 @@
 #include "SDL_rect.h"
 #include "base-gauge.h"
 #include "misc.h"
+#include "perf-counters.h"
 #include "sdl-colors.h"
 #include "view.h"
 
@@ -132,6 +133,8 @@ bool base_gauge_add_animation(BaseGauge *self, BaseAnimation *animation)
 void base_gauge_render(BaseGauge *self, Uint32 dt, RenderContext *ctx)
 {
     bool rv;
+
+    PERF_BEGIN(self->ops->name ? self->ops->name : "BaseGauge");
     for(int i = 0; i < self->nanimations; i++){
         if(!self->animations[i]->finished){
             rv = base_animation_loop(self->animations[i], dt);
@@ -142,12 +145,18 @@ void base_gauge_render(BaseGauge *self, Uint32 dt, RenderContext *ctx)
         }
     }
     if(self->dirty){
-        if(self->ops->update_state)
+        if(self->ops->update_state){
+            PERF_BEGIN("update_state");
             self->ops->update_state(self, dt);
+            PERF_END();
+        }
         self->dirty = false;
     }
-    if(self->ops->render)
+    if(self->ops->render){
+        PERF_BEGIN("render");
         self->ops->render(self, dt, ctx);
+        PERF_END();
+    }
     for(int i = 0; i < self->nchildren; i++){
         SDL_Rect child_location = {
             .x = ctx->location->x + self->children[i]->frame.x,
@@ -166,6 +175,7 @@ void base_gauge_render(BaseGauge *self, Uint32 dt, RenderContext *ctx)
             .portion = ctx->portion
         });
     }
+    PERF_END();
 }
 
 /*******TAKEN FROM BUFFERED_GAUGE**************/
@@ -32,6 +32,8 @@ typedef void  (*StateUpdateFunc)(void *self, Uint32 dt);
 typedef void* (*DisposeFunc)(void *self);
 
 typedef struct{
+    const char *name; /*Type name, used by the perf counters*/
+
     RenderFunc render;
     StateUpdateFunc update_state;
 
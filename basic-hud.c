@@ -22,6 +22,7 @@
 #include "tape-gauge.h"
 
 static BaseGaugeOps basic_hud_ops = {
+   .name = "BasicHud",
    .render = (RenderFunc)NULL,
    .update_state = (StateUpdateFunc)NULL,
    .dispose = (DisposeFunc)NULL
@@ -173,9 +174,9 @@ float basic_hud_get(BasicHud *self, HudValue hv)
 
 void basic_hud_attitude_changed(BasicHud *self, AttitudeData *newv)
 {
-    attitude_indicator_set_pitch(self->attitude, newv->pitch, true);
-    attitude_indicator_set_roll(self->attitude, newv->roll, true);
-    compass_gauge_set_value(self->compass, newv->heading, true);
+    attitude_indicator_set_pitch(self->attitude, newv->pitch, !newv->predicted);
+    attitude_indicator_set_roll(self->attitude, newv->roll, !newv->predicted);
+    compass_gauge_set_value(self->compass, newv->heading, !newv->predicted);
     attitude_indicator_set_heading(self->attitude, newv->heading);
 }
 
@@ -195,3 +196,13 @@ void basic_hud_location_changed(BasicHud *self, LocationData *newv)
     alt_group_set_altitude(self->altgroup, newv->altitude);
 }
 
+void basic_hud_frame_changed(BasicHud *self, uint32_t changed, const DataFrame *frame)
+{
+    if(changed & DATA_CHANGED(ATTITUDE_DATA))
+        basic_hud_attitude_changed(self, (AttitudeData*)&frame->attitude);
+    if(changed & DATA_CHANGED(DYNAMICS_DATA))
+        basic_hud_dynamics_changed(self, (DynamicsData*)&frame->dynamics);
+    if(changed & DATA_CHANGED(LOCATION_DATA))
+        basic_hud_location_changed(self, (LocationData*)&frame->location);
+}
+
@@ -57,4 +57,5 @@ void basic_hud_set_values(BasicHud *self, int nvalues, va_list ap);
 void basic_hud_attitude_changed(BasicHud *self, AttitudeData *newv);
 void basic_hud_dynamics_changed(BasicHud *self, DynamicsData *newv);
 void basic_hud_location_changed(BasicHud *self, LocationData *newv);
+void basic_hud_frame_changed(BasicHud *self, uint32_t changed, const DataFrame *frame);
 #endif /* BASIC_HUD_H */
@@ -0,0 +1,467 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+/*
+ * Headless rendering benchmark.
+ *
+ * Renders the same BasicHud/SidePanel/MapGauge stack as main.c into an
+ * offscreen target, feeding it from a deterministic script at a fixed
+ * time step, and prints per-scope p50/p99 timings as JSON on stdout.
+ *
+ * With SDL_gpu a GL context is still needed, on a box without display use
+ * a software rasterizer, e.g:
+ *   SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./bench
+ *
+ * Script format (-s), one keyframe per line, values hold until changed:
+ *   <frame> key=value [key=value ...]
+ * keys: lat lon alt roll pitch heading ias vs slip rpm ff oilt oilp cht
+ * fuelpx fuelqty. Lines starting with # are ignored. Without a script a
+ * built-in sweep of all the values is used.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include <SDL2/SDL.h>
+#if USE_SDL_GPU
+#include <SDL_gpu.h>
+#endif
+
+#include "base-gauge.h"
+#include "basic-hud.h"
+#include "data-source.h"
+#include "map-gauge.h"
+#include "misc.h"
+#include "mock-data-source.h"
+#include "perf-counters.h"
+#include "resource-manager.h"
+#include "side-panel.h"
+
+#if !ENABLE_PERF_COUNTERS
+#error "bench needs ENABLE_PERF_COUNTERS=1"
+#endif
+
+#define SCREEN_WIDTH 640
+#define SCREEN_HEIGHT 480
+
+#define DEFAULT_FRAMES 2000
+#define DEFAULT_WARMUP 100
+#define FRAME_DT 20 /*ms, same cap as main.c*/
+
+typedef struct{
+    double lat, lon;
+    float alt;
+    float roll, pitch, heading;
+    float ias, vs, slip;
+    float rpm, ff, oilt, oilp, cht, fuelpx, fuelqty;
+}BenchState;
+
+typedef struct{
+    const char *key;
+    size_t offset;
+    bool is_double;
+}BenchField;
+
+#define FIELD(k, m, d) {k, offsetof(BenchState, m), d}
+static BenchField fields[] = {
+    FIELD("lat", lat, true),
+    FIELD("lon", lon, true),
+    FIELD("alt", alt, false),
+    FIELD("roll", roll, false),
+    FIELD("pitch", pitch, false),
+    FIELD("heading", heading, false),
+    FIELD("ias", ias, false),
+    FIELD("vs", vs, false),
+    FIELD("slip", slip, false),
+    FIELD("rpm", rpm, false),
+    FIELD("ff", ff, false),
+    FIELD("oilt", oilt, false),
+    FIELD("oilp", oilp, false),
+    FIELD("cht", cht, false),
+    FIELD("fuelpx", fuelpx, false),
+    FIELD("fuelqty", fuelqty, false),
+    {NULL, 0, false}
+};
+
+typedef struct{
+    FILE *fp;
+    char line[512];
+    long next_frame; /*-1 when exhausted*/
+    char *pending; /*assignments of the line that has been read ahead*/
+}BenchScript;
+
+typedef struct{
+    uint64_t *samples[PERF_MAX_COUNTERS];
+    size_t nsamples[PERF_MAX_COUNTERS];
+    uint64_t frame_acc[PERF_MAX_COUNTERS];
+    size_t asamples;
+}BenchSamples;
+
+static bool bench_script_read_ahead(BenchScript *self)
+{
+    char *end;
+
+    while(fgets(self->line, sizeof(self->line), self->fp)){
+        char *p = self->line;
+
+        while(*p == ' ' || *p == '\t') p++;
+        if(*p == '#' || *p == '\n' || *p == '\0')
+            continue;
+        self->next_frame = strtol(p, &end, 10);
+        if(end == p){
+            printf("Bad script line (no frame number): %s", self->line);
+            continue;
+        }
+        self->pending = end;
+        return true;
+    }
+    self->next_frame = -1;
+    return false;
+}
+
+static void bench_script_apply(BenchScript *self, long frame, BenchState *state)
+{
+    while(self->next_frame >= 0 && self->next_frame <= frame){
+        char *tok, *saveptr;
+
+        for(tok = strtok_r(self->pending, " \t\n", &saveptr); tok; tok = strtok_r(NULL, " \t\n", &saveptr)){
+            char *eq = strchr(tok, '=');
+            BenchField *f;
+
+            if(!eq){
+                printf("Bad script token: %s\n", tok);
+                continue;
+            }
+            *eq = '\0';
+            for(f = fields; f->key && strcmp(f->key, tok); f++);
+            if(!f->key){
+                printf("Unknown script key: %s\n", tok);
+                continue;
+            }
+            if(f->is_double)
+                *(double*)((char*)state + f->offset) = strtod(eq+1, NULL);
+            else
+                *(float*)((char*)state + f->offset) = strtof(eq+1, NULL);
+        }
+        bench_script_read_ahead(self);
+    }
+}
+
+/*Built-in deterministic sweep, exercises every gauge*/
+static void bench_builtin_script(long frame, BenchState *state)
+{
+    double t = frame / 50.0; /*seconds at FRAME_DT*/
+
+    state->lat = 45.215470 + t * 0.0005;
+    state->lon = 5.844828 + t * 0.0005;
+    state->alt = 2000 + 1500 * sin(t / 7.0);
+    state->roll = 45 * sin(t / 3.0);
+    state->pitch = 15 * sin(t / 5.0);
+    state->heading = fmod(t * 6.0, 360.0);
+    state->ias = 110 + 60 * sin(t / 11.0);
+    state->vs = 15 * cos(t / 7.0); /*fps*/
+    state->slip = 0.1 * sin(t / 2.0);
+    state->rpm = 2400 + 500 * sin(t / 13.0);
+    state->ff = 7 + 2 * sin(t / 17.0);
+    state->oilt = 180 + 60 * sin(t / 19.0);
+    state->oilp = 50 + 40 * sin(t / 23.0);
+    state->cht = 350 + 200 * sin(t / 29.0);
+    state->fuelpx = 4 + 4 * sin(t / 31.0);
+    state->fuelqty = 25 - fmod(t / 10.0, 25.0);
+}
+
+static void bench_feed(DataSource *ds, BenchState *state)
+{
+    data_source_set_location(ds, &(LocationData){
+        .super.latitude = state->lat,
+        .super.longitude = state->lon,
+        .altitude = state->alt
+    });
+    data_source_set_attitude(ds, &(AttitudeData){
+        .roll = state->roll,
+        .pitch = state->pitch,
+        .heading = state->heading
+    });
+    data_source_set_dynamics(ds, &(DynamicsData){
+        .airspeed = state->ias,
+        .vertical_speed = state->vs,
+        .slip_rad = state->slip
+    });
+    data_source_set_engine_data(ds, &(EngineData){
+        .rpm = state->rpm,
+        .fuel_flow = state->ff,
+        .oil_temp = state->oilt,
+        .oil_press = state->oilp,
+        .cht = state->cht,
+        .fuel_px = state->fuelpx,
+        .fuel_qty = state->fuelqty
+    });
+    data_source_dispatch_frame(ds);
+}
+
+/*Per-frame cost of each scope: a scope hit several times in a frame is summed*/
+static void bench_samples_collect(BenchSamples *self)
+{
+    PerfCounters *pc = perf_counters_get_instance();
+
+    for(int i = 0; i < pc->nevents; i++){
+        if(!pc->events[i].counter)
+            continue;
+        self->frame_acc[pc->events[i].counter - pc->counters] += pc->events[i].duration_ns;
+    }
+    for(int i = 0; i < pc->ncounters; i++){
+        if(!self->frame_acc[i])
+            continue;
+        if(!self->samples[i]){
+            self->samples[i] = malloc(sizeof(uint64_t) * self->asamples);
+            if(!self->samples[i]){
+                self->frame_acc[i] = 0;
+                continue;
+            }
+        }
+        self->samples[i][self->nsamples[i]++] = self->frame_acc[i];
+        self->frame_acc[i] = 0;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t*)a;
+    uint64_t vb = *(const uint64_t*)b;
+    return (va > vb) - (va < vb);
+}
+
+static void bench_samples_report(BenchSamples *self, FILE *out, long frames, double wall_ms)
+{
+    PerfCounters *pc = perf_counters_get_instance();
+    bool first = true;
+
+    fprintf(out, "{\n  \"frames\": %ld,\n  \"dt_ms\": %d,\n  \"wall_ms\": %.3f,\n",
+        frames, FRAME_DT, wall_ms
+    );
+    fprintf(out, "  \"backend\": \"%s\",\n  \"scopes\": [",
+#if USE_SDL_GPU
+        "sdl_gpu"
+#else
+        "sdl_surface"
+#endif
+    );
+    for(int i = 0; i < pc->ncounters; i++){
+        PerfCounter *c = &pc->counters[i];
+        uint64_t *s = self->samples[i];
+        size_t n = self->nsamples[i];
+        double sum = 0;
+
+        if(!n) continue;
+        qsort(s, n, sizeof(uint64_t), cmp_u64);
+        for(int j = 0; j < n; j++)
+            sum += s[j];
+        fprintf(out,
+            "%s\n    {\"scope\": \"%s\", \"parent\": %s%s%s, \"depth\": %d, "
+            "\"frames\": %zu, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+            "\"p99_us\": %.3f, \"max_us\": %.3f}",
+            first ? "" : ",",
+            c->name,
+            c->parent ? "\"" : "", c->parent ? c->parent : "null", c->parent ? "\"" : "",
+            c->depth, n,
+            sum / n / 1000.0,
+            s[(n-1) * 50 / 100] / 1000.0,
+            s[(n-1) * 99 / 100] / 1000.0,
+            s[n-1] / 1000.0
+        );
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-n frames] [-w warmup frames] [-s script] [-o output.json] [-t trace.json]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    long nframes = DEFAULT_FRAMES;
+    long nwarmup = DEFAULT_WARMUP;
+    const char *script_file = NULL;
+    const char *output_file = NULL;
+    const char *trace_file = NULL;
+    BenchScript script = {0};
+    BenchSamples samples = {0};
+    BenchState state = {0};
+    RenderTarget rtarget;
+    DataSource *ds;
+    FILE *out;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-n") && i+1 < argc)
+            nframes = strtol(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "-w") && i+1 < argc)
+            nwarmup = strtol(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "-s") && i+1 < argc)
+            script_file = argv[++i];
+        else if(!strcmp(argv[i], "-o") && i+1 < argc)
+            output_file = argv[++i];
+        else if(!strcmp(argv[i], "-t") && i+1 < argc)
+            trace_file = argv[++i];
+        else{
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(nframes <= 0 || nwarmup < 0){
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(script_file){
+        script.fp = fopen(script_file, "r");
+        if(!script.fp){
+            printf("Couldn't open script %s, bailing out\n", script_file);
+            exit(EXIT_FAILURE);
+        }
+        bench_script_read_ahead(&script);
+    }
+
+#if USE_SDL_GPU
+    GPU_Target *screen;
+    GPU_Image *offscreen;
+
+    GPU_SetPreInitFlags(GPU_INIT_DISABLE_VSYNC);
+	GPU_SetRequiredFeatures(GPU_FEATURE_BASIC_SHADERS);
+#if USE_GLES
+    screen = GPU_InitRenderer(GPU_RENDERER_GLES_2, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+#else
+    screen = GPU_InitRenderer(GPU_RENDERER_OPENGL_2, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+#endif
+    if(!screen){
+        GPU_LogError("Couldn't create a GL context, try SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1\n");
+        exit(EXIT_FAILURE);
+    }
+    offscreen = GPU_CreateImage(SCREEN_WIDTH, SCREEN_HEIGHT, GPU_FORMAT_RGBA);
+    if(!offscreen || !GPU_LoadTarget(offscreen)){
+        GPU_LogError("Couldn't create offscreen target\n");
+        exit(EXIT_FAILURE);
+    }
+    rtarget.target = offscreen->target;
+#else
+    SDL_Surface *offscreen;
+
+    offscreen = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(!offscreen){
+        printf("Couldn't create offscreen surface: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    rtarget.surface = offscreen;
+#endif
+
+    ds = DATA_SOURCE(mock_data_source_new());
+    data_source_set(ds);
+    data_source_set_deadbands(ds, &data_source_display_deadbands);
+
+    BasicHud *hud = basic_hud_new();
+    hud->attitude->mode = AI_MODE_2D;
+    SDL_Rect whole = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+    SidePanel *panel = side_panel_new(-1, -1);
+    SDL_Rect sprect = {0, 0, base_gauge_w(BASE_GAUGE(panel)), base_gauge_h(BASE_GAUGE(panel))};
+
+    MapGauge *map = map_gauge_new(190, 150);
+    map->level = 7;
+    SDL_Rect maprect = {SCREEN_WIDTH-200, SCREEN_HEIGHT-160, base_gauge_w(BASE_GAUGE(map)), base_gauge_h(BASE_GAUGE(map))};
+
+    /*Same wiring as main.c --bench-tape*/
+    data_source_add_frame_listener(ds, &(FrameListener){
+        .callback = (FrameListenerFunc)basic_hud_frame_changed,
+        .target = hud,
+        .mask = DATA_CHANGED(ATTITUDE_DATA) | DATA_CHANGED(DYNAMICS_DATA) | DATA_CHANGED(LOCATION_DATA),
+        .priority = 1 /*Primary flight instruments first*/
+    });
+    data_source_add_listener(ds, ENGINE_DATA, &(ValueListener){
+        .callback = (ValueListenerFunc)side_panel_engine_data_changed,
+        .target = panel
+    });
+    data_source_add_frame_listener(ds, &(FrameListener){
+        .callback = (FrameListenerFunc)map_gauge_frame_changed,
+        .target = map,
+        .mask = DATA_CHANGED(LOCATION_DATA) | DATA_CHANGED(ATTITUDE_DATA) | DATA_CHANGED(ROUTE_DATA)
+        /* No .period: it is wall-clock time, the number of map updates
+         * would depend on the machine speed*/
+    });
+
+    samples.asamples = nframes;
+    uint64_t start_ns = 0;
+    for(long frame = 0; frame < nwarmup + nframes; frame++){
+        if(frame == nwarmup){
+            start_ns = monotonic_ns();
+            if(trace_file)
+                perf_counters_start_trace(trace_file);
+        }
+
+        PERF_FRAME_BEGIN();
+        PERF_BEGIN("data_source");
+        if(script.fp)
+            bench_script_apply(&script, frame, &state);
+        else
+            bench_builtin_script(frame, &state);
+        bench_feed(ds, &state);
+        PERF_END();
+
+        PERF_BEGIN("gauges");
+#if USE_SDL_GPU
+        GPU_ClearRGB(rtarget.target, 0x11, 0x56, 0xFF);
+#else
+        SDL_FillRect(offscreen, NULL, SDL_MapRGB(offscreen->format, 0x11, 0x56, 0xFF));
+#endif
+        base_gauge_render(BASE_GAUGE(hud), FRAME_DT, &(RenderContext){rtarget, &whole, NULL});
+        base_gauge_render(BASE_GAUGE(panel), FRAME_DT, &(RenderContext){rtarget, &sprect, NULL});
+        base_gauge_render(BASE_GAUGE(map), FRAME_DT, &(RenderContext){rtarget, &maprect, NULL});
+        PERF_END();
+
+        /*Stands for the flip: make sure queued blits are actually issued*/
+        PERF_BEGIN("flush");
+#if USE_SDL_GPU
+        GPU_FlushBlitBuffer();
+#endif
+        PERF_END();
+        PERF_FRAME_END();
+
+        if(frame >= nwarmup)
+            bench_samples_collect(&samples);
+    }
+    double wall_ms = (monotonic_ns() - start_ns) / 1000000.0;
+    perf_counters_stop_trace();
+
+    out = output_file ? fopen(output_file, "w") : stdout;
+    if(!out){
+        printf("Couldn't open %s for writing, using stdout\n", output_file);
+        out = stdout;
+    }
+    bench_samples_report(&samples, out, nframes, wall_ms);
+    if(out != stdout)
+        fclose(out);
+
+    for(int i = 0; i < PERF_MAX_COUNTERS; i++)
+        free(samples.samples[i]);
+    if(script.fp)
+        fclose(script.fp);
+    base_gauge_free(BASE_GAUGE(hud));
+    base_gauge_free(BASE_GAUGE(panel));
+    base_gauge_free(BASE_GAUGE(map));
+    data_source_free(ds);
+    resource_manager_shutdown();
+#if USE_SDL_GPU
+    GPU_FreeImage(offscreen);
+	GPU_Quit();
+#else
+    SDL_FreeSurface(offscreen);
+#endif
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "broadcast-data-source.h"
+
+static bool broadcast_data_source_frame(BroadcastDataSource *self, uint32_t dt);
+static BroadcastDataSource *broadcast_data_source_dispose(BroadcastDataSource *self);
+static DataSourceOps broadcast_data_source_ops = {
+    .frame = (DataSourceFrameFunc)broadcast_data_source_frame,
+    .dispose = (DataSourceDisposeFunc)broadcast_data_source_dispose
+};
+
+/**
+ * @param group Multicast address, NULL for DATA_PUBLISHER_GROUP
+ * @param port 0 for DATA_PUBLISHER_PORT
+ */
+BroadcastDataSource *broadcast_data_source_new(const char *group, int port)
+{
+    BroadcastDataSource *self;
+
+    self = calloc(1, sizeof(BroadcastDataSource));
+    if(self){
+        if(!broadcast_data_source_init(self, group, port)){
+            data_source_free(DATA_SOURCE(self));
+            return NULL;
+        }
+    }
+    return self;
+}
+
+BroadcastDataSource *broadcast_data_source_init(BroadcastDataSource *self, const char *group, int port)
+{
+    if(!data_source_init(DATA_SOURCE(self), &broadcast_data_source_ops))
+        return NULL;
+
+    group = group ? group : DATA_PUBLISHER_GROUP;
+    port = port ? port : DATA_PUBLISHER_PORT;
+    if(!udp_ingest_init_group(&self->ingest, group, port, DATA_PACKET_MAX_SIZE))
+        return NULL;
+    printf("Listening for SoFIS data on %s:%d\n", group, port);
+
+    return self;
+}
+
+static BroadcastDataSource *broadcast_data_source_dispose(BroadcastDataSource *self)
+{
+    if(self->ingest.stats.received){
+        udp_ingest_stats_print(&self->ingest.stats, "BroadcastDataSource");
+        printf("BroadcastDataSource: %llu out of order\n", (unsigned long long)self->stale);
+    }
+    udp_ingest_dispose(&self->ingest);
+    return self;
+}
+
+static bool broadcast_data_source_frame(BroadcastDataSource *self, uint32_t dt)
+{
+    const uint8_t *buffer;
+    DataPacket packet;
+    size_t len;
+
+    if(udp_ingest_drain(&self->ingest) <= 0)
+        return false;
+    /*Each packet has the whole state, only the latest one matters*/
+    buffer = udp_ingest_latest(&self->ingest, &len);
+    if(!buffer || !data_packet_decode(&packet, buffer, len))
+        return false;
+
+    /*A new session means that the publisher has been restarted*/
+    if(self->has_session && packet.session == self->session
+       && (int32_t)(packet.seq - self->seq) <= 0)
+    {
+        self->stale++;
+        return false;
+    }
+    self->has_session = true;
+    self->session = packet.session;
+    self->seq = packet.seq;
+
+    /*Timestamps are zero: stamped here, on arrival*/
+    data_source_set_location(DATA_SOURCE(self), &packet.frame.location);
+    data_source_set_attitude(DATA_SOURCE(self), &packet.frame.attitude);
+    data_source_set_dynamics(DATA_SOURCE(self), &packet.frame.dynamics);
+    data_source_set_engine_data(DATA_SOURCE(self), &packet.frame.engine_data);
+    /* Only follow route changes made on the publisher, leaving the ones
+     * made locally alone*/
+    if(!route_data_equals(&packet.frame.route, &self->route)){
+        self->route = packet.frame.route;
+        data_source_set_route_data(DATA_SOURCE(self), &packet.frame.route);
+    }
+    if(packet.flags & DATA_PACKET_HAS_FIX)
+        data_source_set_fix(DATA_SOURCE(self));
+
+    return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef BROADCAST_DATA_SOURCE_H
+#define BROADCAST_DATA_SOURCE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data-source.h"
+#include "data-publisher.h"
+#include "udp-ingest.h"
+
+/* Gets its values from another SoFIS running a DataPublisher. Reading
+ * never blocks: poll it from the rendering thread, without an acquisition
+ * thread, as route changes are handed over as well.*/
+typedef struct{
+    DataSource super;
+
+    UdpIngest ingest;
+
+    bool has_session;
+    uint32_t session;
+    uint32_t seq; /*Last one applied*/
+    RouteData route; /*Last one received*/
+    uint64_t stale; /*Out of order packets, discarded*/
+}BroadcastDataSource;
+
+BroadcastDataSource *broadcast_data_source_new(const char *group, int port);
+BroadcastDataSource *broadcast_data_source_init(BroadcastDataSource *self, const char *group, int port);
+#endif /* BROADCAST_DATA_SOURCE_H */
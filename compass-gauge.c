@@ -20,6 +20,7 @@ static void compass_gauge_render(CompassGauge *self, Uint32 dt, RenderContext *c
 static void compass_gauge_update_state(CompassGauge *self, Uint32 dt);
 static void *compass_gauge_dispose(CompassGauge *self);
 static BaseGaugeOps compass_gauge_ops = {
+   .name = "CompassGauge",
    .render = (RenderFunc)compass_gauge_render,
    .update_state = (StateUpdateFunc)compass_gauge_update_state,
    .dispose = (DisposeFunc)compass_gauge_dispose
@@ -0,0 +1,240 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "composite-data-source.h"
+#include "misc.h"
+
+static const char *type_names[COMPOSITE_NTYPES] = {
+    [LOCATION_DATA] = "location",
+    [ATTITUDE_DATA] = "attitude",
+    [DYNAMICS_DATA] = "dynamics",
+    [ENGINE_DATA] = "engine data"
+};
+
+static bool composite_data_source_frame(CompositeDataSource *self, uint32_t dt);
+static CompositeDataSource *composite_data_source_dispose(CompositeDataSource *self);
+static DataSourceOps composite_data_source_ops = {
+    .frame = (DataSourceFrameFunc)composite_data_source_frame,
+    .dispose = (DataSourceDisposeFunc)composite_data_source_dispose
+};
+
+CompositeDataSource *composite_data_source_new(void)
+{
+    CompositeDataSource *self;
+
+    self = calloc(1, sizeof(CompositeDataSource));
+    if(self){
+        if(!composite_data_source_init(self)){
+            data_source_free(DATA_SOURCE(self));
+            return NULL;
+        }
+    }
+    return self;
+}
+
+CompositeDataSource *composite_data_source_init(CompositeDataSource *self)
+{
+    if(!data_source_init(DATA_SOURCE(self), &composite_data_source_ops))
+        return NULL;
+    self->stale_timeout = COMPOSITE_STALE_TIMEOUT;
+    return self;
+}
+
+static CompositeDataSource *composite_data_source_dispose(CompositeDataSource *self)
+{
+    for(size_t i = 0; i < self->nchildren; i++)
+        data_source_free(self->children[i].source);
+    self->nchildren = 0;
+    return self;
+}
+
+static void composite_child_changed(CompositeChild *self, uint32_t changed, const DataFrame *frame)
+{
+    self->seen |= changed;
+    self->changed |= changed;
+
+    if(changed & DATA_CHANGED(LOCATION_DATA))
+        self->last[LOCATION_DATA] = frame->location.timestamp;
+    if(changed & DATA_CHANGED(ATTITUDE_DATA))
+        self->last[ATTITUDE_DATA] = frame->attitude.timestamp;
+    if(changed & DATA_CHANGED(DYNAMICS_DATA))
+        self->last[DYNAMICS_DATA] = frame->dynamics.timestamp;
+    if(changed & DATA_CHANGED(ENGINE_DATA))
+        self->last[ENGINE_DATA] = frame->engine_data.timestamp;
+}
+
+/**
+ * @brief Adds a source to take values from. The composite owns @p child
+ * from then on, even if this fails.
+ *
+ * Real sensors never deliver the exact same value twice in a row: a
+ * value that doesn't change for stale_timeout ms is deemed stale.
+ *
+ * @param name For messages, e.g. when the source wins or loses a value
+ * @param child The source, that the composite will free
+ * @param period Acquisition period of @p child on its own thread, ms. 0
+ * polls it from the composite frame function instead.
+ * @param ntypes Number of DataType/quality couples that follows
+ * @param ... couples of DataType/int: the values taken from @p child
+ * and how good they are compared to other sources. Higher is better.
+ * @return true on success, false otherwise
+ */
+bool composite_data_source_add(CompositeDataSource *self, const char *name,
+                               DataSource *child, uint32_t period,
+                               size_t ntypes, ...)
+{
+    CompositeChild *entry;
+    va_list args;
+    bool rv;
+
+    if(!child){
+        printf("%s: couldn't create %s, going on without\n", __FUNCTION__, name);
+        return false;
+    }
+    if(self->nchildren == COMPOSITE_MAX_CHILDREN){
+        printf("%s: too many sources, please increment COMPOSITE_MAX_CHILDREN\n", __FUNCTION__);
+        data_source_free(child);
+        return false;
+    }
+
+    entry = &self->children[self->nchildren];
+    *entry = (CompositeChild){
+        .name = name,
+        .source = child
+    };
+    va_start(args, ntypes);
+    for(int i = 0; i < ntypes; i++){
+        DataType type = va_arg(args, DataType);
+        int quality = va_arg(args, int);
+        if(type >= COMPOSITE_NTYPES)
+            continue;
+        entry->types |= DATA_CHANGED(type);
+        entry->quality[type] = quality;
+    }
+    va_end(args);
+
+    rv = data_source_add_frame_listener(child, &(FrameListener){
+        .callback = (FrameListenerFunc)composite_child_changed,
+        .target = entry,
+        .mask = entry->types
+    });
+    if(!rv){
+        data_source_free(child);
+        return false;
+    }
+    self->nchildren++;
+
+    if(period && !data_source_start_acquisition(child, period))
+        printf("%s: couldn't start %s acquisition thread, polling it\n", __FUNCTION__, name);
+    return true;
+}
+
+/*Whether @p a is a better source than @p b for @p type*/
+static inline bool composite_child_better(CompositeDataSource *self, DataType type,
+                                          CompositeChild *a, CompositeChild *b)
+{
+    if(!b)
+        return true;
+    if(a->quality[type] != b->quality[type])
+        return a->quality[type] > b->quality[type];
+    /*Among equals, stick to the current one rather than flip-flopping*/
+    if(b == self->winners[type])
+        return false;
+    if(a == self->winners[type])
+        return true;
+    return a->last[type] > b->last[type];
+}
+
+static CompositeChild *composite_data_source_elect(CompositeDataSource *self, DataType type, uint64_t now)
+{
+    CompositeChild *rv, *child;
+    uint64_t stale;
+
+    stale = (uint64_t)self->stale_timeout * 1000000;
+    rv = NULL;
+    for(size_t i = 0; i < self->nchildren; i++){
+        child = &self->children[i];
+        if(!(child->types & child->seen & DATA_CHANGED(type)))
+            continue;
+        if(now > child->last[type] && now - child->last[type] > stale)
+            continue;
+        if(composite_child_better(self, type, child, rv))
+            rv = child;
+    }
+    /*Everything is stale, nothing better to do than waiting*/
+    return rv ? rv : self->winners[type];
+}
+
+static void composite_data_source_forward(CompositeDataSource *self, CompositeChild *child, DataType type)
+{
+    DataFrame *frame = &child->source->frame;
+    LocationData location;
+    AttitudeData attitude;
+    DynamicsData dynamics;
+    EngineData engine_data;
+
+    /*Setters can stamp what they get, leave the child's frame alone*/
+    switch(type){
+        case LOCATION_DATA:
+            location = frame->location;
+            data_source_set_location(DATA_SOURCE(self), &location);
+            break;
+        case ATTITUDE_DATA:
+            attitude = frame->attitude;
+            data_source_set_attitude(DATA_SOURCE(self), &attitude);
+            break;
+        case DYNAMICS_DATA:
+            dynamics = frame->dynamics;
+            data_source_set_dynamics(DATA_SOURCE(self), &dynamics);
+            break;
+        case ENGINE_DATA:
+            engine_data = frame->engine_data;
+            data_source_set_engine_data(DATA_SOURCE(self), &engine_data);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool composite_data_source_frame(CompositeDataSource *self, uint32_t dt)
+{
+    CompositeChild *child, *winner;
+    uint64_t now;
+    bool rv;
+
+    /*Picks up whatever the children threads published*/
+    for(size_t i = 0; i < self->nchildren; i++){
+        child = &self->children[i];
+        data_source_frame(child->source, dt);
+        if(child->source->has_fix)
+            data_source_set_fix(DATA_SOURCE(self));
+    }
+
+    now = monotonic_ns();
+    rv = false;
+    for(DataType type = LOCATION_DATA; type < COMPOSITE_NTYPES; type++){
+        winner = composite_data_source_elect(self, type, now);
+        if(!winner)
+            continue;
+        if(winner != self->winners[type]){
+            printf("%s: %s now from %s\n", __FUNCTION__, type_names[type], winner->name);
+            self->winners[type] = winner;
+        }else if(!(winner->changed & DATA_CHANGED(type))){
+            continue;
+        }
+        composite_data_source_forward(self, winner, type);
+        rv = true;
+    }
+
+    for(size_t i = 0; i < self->nchildren; i++)
+        self->children[i].changed = 0;
+    return rv;
+}
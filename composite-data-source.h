@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef COMPOSITE_DATA_SOURCE_H
+#define COMPOSITE_DATA_SOURCE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data-source.h"
+
+#define COMPOSITE_MAX_CHILDREN 4
+#define COMPOSITE_STALE_TIMEOUT 1000 /*ms*/
+#define COMPOSITE_NTYPES (ENGINE_DATA+1) /*Route data is set by the user, not acquired*/
+
+typedef struct{
+    const char *name;
+    DataSource *source;
+
+    uint32_t types; /*DATA_CHANGED bits of the values taken from this source*/
+    int quality[COMPOSITE_NTYPES]; /*Per type, higher wins*/
+
+    uint32_t seen; /*DATA_CHANGED bits of the values delivered at least once*/
+    uint32_t changed; /*DATA_CHANGED bits of the values delivered since the last frame*/
+    uint64_t last[COMPOSITE_NTYPES]; /*Timestamp of the latest value of each type*/
+}CompositeChild;
+
+/* Runs several sources at once and takes each kind of value (location,
+ * attitude, ...) from the best one that is still alive: the one with the
+ * highest quality for that kind among those that delivered a value within
+ * the last stale_timeout ms. When it goes stale, the next best takes over
+ * in the very same frame.
+ *
+ * Each child acquires on its own thread, a slow one never holds up the
+ * others.
+ */
+typedef struct{
+    DataSource super;
+
+    CompositeChild children[COMPOSITE_MAX_CHILDREN];
+    size_t nchildren;
+    CompositeChild *winners[COMPOSITE_NTYPES];
+
+    uint32_t stale_timeout; /*ms*/
+}CompositeDataSource;
+
+CompositeDataSource *composite_data_source_new(void);
+CompositeDataSource *composite_data_source_init(CompositeDataSource *self);
+
+bool composite_data_source_add(CompositeDataSource *self, const char *name,
+                               DataSource *child, uint32_t period,
+                               size_t ntypes, ...);
+#endif /* COMPOSITE_DATA_SOURCE_H */
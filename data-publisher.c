@@ -0,0 +1,250 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "data-publisher.h"
+#include "misc.h"
+
+#define HEADER_SIZE (sizeof(DATA_PACKET_MAGIC) - 1 + 1 + 1 + 1 + 4 + 4)
+
+typedef struct{
+    size_t offset; /*in DataFrame*/
+    size_t size;
+}DataPacketField;
+
+#define PACKET_FIELD(member) {offsetof(DataFrame, member), sizeof(((DataFrame*)0)->member)}
+static const DataPacketField packet_fields[] = {
+    PACKET_FIELD(location.super.latitude),
+    PACKET_FIELD(location.super.longitude),
+    PACKET_FIELD(location.altitude),
+
+    PACKET_FIELD(attitude.roll),
+    PACKET_FIELD(attitude.pitch),
+    PACKET_FIELD(attitude.heading),
+
+    PACKET_FIELD(dynamics.airspeed),
+    PACKET_FIELD(dynamics.vertical_speed),
+    PACKET_FIELD(dynamics.slip_rad),
+    PACKET_FIELD(dynamics.groundspeed),
+    PACKET_FIELD(dynamics.track),
+
+    PACKET_FIELD(engine_data.rpm),
+    PACKET_FIELD(engine_data.fuel_flow),
+    PACKET_FIELD(engine_data.fuel_px),
+    PACKET_FIELD(engine_data.oil_temp),
+    PACKET_FIELD(engine_data.oil_press),
+    PACKET_FIELD(engine_data.cht),
+    PACKET_FIELD(engine_data.fuel_qty),
+    PACKET_FIELD(engine_data.egt),
+    PACKET_FIELD(engine_data.man_press),
+    PACKET_FIELD(engine_data.volts),
+
+    PACKET_FIELD(route.to.latitude),
+    PACKET_FIELD(route.to.longitude),
+    PACKET_FIELD(route.from.latitude),
+    PACKET_FIELD(route.from.longitude),
+};
+#define N_PACKET_FIELDS (sizeof(packet_fields)/sizeof(packet_fields[0]))
+
+static void data_publisher_frame_changed(DataPublisher *self, uint32_t changed, const DataFrame *frame);
+
+/**
+ * @brief Starts multicasting the state of @p source.
+ *
+ * @param group Multicast address, NULL for DATA_PUBLISHER_GROUP
+ * @param port 0 for DATA_PUBLISHER_PORT
+ * @return The publisher, NULL on error
+ */
+DataPublisher *data_publisher_new(DataSource *source, const char *group, int port)
+{
+    DataPublisher *self;
+    uint8_t ttl = 1; /*Local network only*/
+    bool rv;
+
+    self = calloc(1, sizeof(DataPublisher));
+    if(!self)
+        return NULL;
+    self->source = source;
+    self->session = monotonic_ns() / 1000;
+
+    group = group ? group : DATA_PUBLISHER_GROUP;
+    self->group.sin_family = AF_INET;
+    self->group.sin_port = htons(port ? port : DATA_PUBLISHER_PORT);
+    if(!inet_aton(group, &self->group.sin_addr)){
+        printf("%s: %s is not a valid address\n", __FUNCTION__, group);
+        free(self);
+        return NULL;
+    }
+
+    self->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(self->fd < 0){
+        printf("%s: couldn't create socket: %s\n", __FUNCTION__, strerror(errno));
+        free(self);
+        return NULL;
+    }
+    if(setsockopt(self->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+        printf("%s: couldn't set TTL: %s\n", __FUNCTION__, strerror(errno));
+
+    rv = data_source_add_frame_listener(source, &(FrameListener){
+        .callback = (FrameListenerFunc)data_publisher_frame_changed,
+        .target = self,
+        .mask = ALL_DATA_CHANGED,
+        .priority = -1 /*Local gauges first*/
+    });
+    if(!rv){
+        close(self->fd);
+        free(self);
+        return NULL;
+    }
+    return self;
+}
+
+void data_publisher_free(DataPublisher *self)
+{
+    data_source_remove_frame_listener(self->source, self, (FrameListenerFunc)data_publisher_frame_changed);
+    printf("DataPublisher: %llu packets sent, %llu failed\n",
+        (unsigned long long)self->sent,
+        (unsigned long long)self->failed
+    );
+    close(self->fd);
+    free(self);
+}
+
+static void data_publisher_send(DataPublisher *self, uint32_t changed, const DataFrame *frame)
+{
+    uint8_t buffer[DATA_PACKET_MAX_SIZE];
+    DataPacket packet;
+    size_t len;
+    ssize_t rv;
+
+    packet = (DataPacket){
+        .flags =  (self->source->has_fix ? DATA_PACKET_HAS_FIX : 0)
+                | (frame->attitude.predicted ? DATA_PACKET_PREDICTED : 0),
+        .changed = changed,
+        .session = self->session,
+        .seq = self->seq++,
+        .frame = *frame
+    };
+    len = data_packet_encode(&packet, buffer);
+
+    rv = sendto(self->fd, buffer, len, MSG_DONTWAIT,
+        (struct sockaddr*)&self->group, sizeof(self->group)
+    );
+    if(rv == len){
+        self->sent++;
+    }else{
+        /*Nobody to warn in flight, the next frame will make up for it*/
+        self->failed++;
+    }
+    self->last_sent = monotonic_ns();
+}
+
+static void data_publisher_frame_changed(DataPublisher *self, uint32_t changed, const DataFrame *frame)
+{
+    data_publisher_send(self, changed, frame);
+}
+
+/**
+ * @brief Sends the whole state again if nothing has been sent for
+ * DATA_PUBLISHER_REFRESH, so that displays started later, or that lost
+ * the last change, catch up even when nothing moves (parked aircraft,
+ * paused tape, values within deadbands). To be called every frame.
+ */
+void data_publisher_tick(DataPublisher *self)
+{
+    if(monotonic_ns() - self->last_sent < DATA_PUBLISHER_REFRESH * 1000000ULL)
+        return;
+    data_publisher_send(self, 0, &self->source->frame);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    for(int i = 0; i < 4; i++)
+        p[i] = v >> (8 * i);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    uint32_t v = 0;
+
+    for(int i = 0; i < 4; i++)
+        v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+/**
+ * @brief Serializes @p packet into @p buffer, that must hold at least
+ * DATA_PACKET_MAX_SIZE bytes.
+ *
+ * @return The number of bytes written
+ */
+size_t data_packet_encode(const DataPacket *packet, uint8_t *buffer)
+{
+    uint8_t *p = buffer;
+
+    memcpy(p, DATA_PACKET_MAGIC, sizeof(DATA_PACKET_MAGIC) - 1);
+    p += sizeof(DATA_PACKET_MAGIC) - 1;
+    *p++ = DATA_PACKET_VERSION;
+    *p++ = packet->flags;
+    *p++ = packet->changed;
+    put_u32(p, packet->session);
+    p += 4;
+    put_u32(p, packet->seq);
+    p += 4;
+
+    for(int i = 0; i < N_PACKET_FIELDS; i++){
+        memcpy(p, (uint8_t*)&packet->frame + packet_fields[i].offset, packet_fields[i].size);
+        p += packet_fields[i].size;
+    }
+    return p - buffer;
+}
+
+/**
+ * @brief Reads a packet written by data_packet_encode. Fields that are
+ * not part of the packet (timestamps) are zeroed.
+ *
+ * @return true on success, false if @p buffer is not a valid packet
+ */
+bool data_packet_decode(DataPacket *packet, const uint8_t *buffer, size_t len)
+{
+    const uint8_t *p = buffer;
+    size_t expected;
+
+    expected = HEADER_SIZE;
+    for(int i = 0; i < N_PACKET_FIELDS; i++)
+        expected += packet_fields[i].size;
+    if(len != expected)
+        return false;
+    if(memcmp(p, DATA_PACKET_MAGIC, sizeof(DATA_PACKET_MAGIC) - 1))
+        return false;
+    p += sizeof(DATA_PACKET_MAGIC) - 1;
+    if(*p++ != DATA_PACKET_VERSION)
+        return false;
+
+    memset(packet, 0, sizeof(DataPacket));
+    packet->flags = *p++;
+    packet->changed = *p++;
+    packet->session = get_u32(p);
+    p += 4;
+    packet->seq = get_u32(p);
+    p += 4;
+
+    for(int i = 0; i < N_PACKET_FIELDS; i++){
+        memcpy((uint8_t*)&packet->frame + packet_fields[i].offset, p, packet_fields[i].size);
+        p += packet_fields[i].size;
+    }
+    packet->frame.attitude.predicted = packet->flags & DATA_PACKET_PREDICTED;
+    return true;
+}
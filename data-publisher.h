@@ -0,0 +1,72 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef DATA_PUBLISHER_H
+#define DATA_PUBLISHER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+
+#include "data-source.h"
+
+#define DATA_PUBLISHER_GROUP "239.255.83.70"
+#define DATA_PUBLISHER_PORT 49780
+/*The whole state is sent at least this often, changes or not*/
+#define DATA_PUBLISHER_REFRESH 500 /*ms*/
+
+#define DATA_PACKET_MAGIC "SFBC"
+#define DATA_PACKET_VERSION 1
+#define DATA_PACKET_MAX_SIZE 256
+
+/*DataPacket.flags*/
+#define DATA_PACKET_HAS_FIX 0x01
+#define DATA_PACKET_PREDICTED 0x02 /*AttitudeData.predicted*/
+
+/* What goes over the wire. Each datagram carries the whole state, so a
+ * lost one is made up for by the next one:
+ *  - magic, version: 4+1 bytes
+ *  - flags, changed (DATA_CHANGED bits): 1+1 bytes
+ *  - session (publisher start time), seq: 4+4 bytes
+ *  - the fields of location, attitude, dynamics, engine data and route,
+ *    floats and doubles in the order of the structs
+ * Everything is little-endian, the host order of every board SoFIS runs
+ * on. Timestamps are not sent: clocks aren't shared, receivers stamp
+ * values on arrival.
+ */
+typedef struct{
+    uint8_t flags;
+    uint8_t changed;
+    uint32_t session;
+    uint32_t seq;
+    DataFrame frame;
+}DataPacket;
+
+/* Multicasts the state of a DataSource on the local network, once per
+ * frame with changes and every DATA_PUBLISHER_REFRESH otherwise (see
+ * data_publisher_tick), for BroadcastDataSource to pick up on other
+ * displays. Sending is a single non-blocking syscall on the rendering
+ * thread.
+ */
+typedef struct{
+    DataSource *source;
+    int fd;
+    struct sockaddr_in group;
+
+    uint32_t session;
+    uint32_t seq;
+    uint64_t last_sent; /*monotonic_ns()*/
+    uint64_t sent;
+    uint64_t failed;
+}DataPublisher;
+
+DataPublisher *data_publisher_new(DataSource *source, const char *group, int port);
+void data_publisher_free(DataPublisher *self);
+void data_publisher_tick(DataPublisher *self);
+
+size_t data_packet_encode(const DataPacket *packet, uint8_t *buffer);
+bool data_packet_decode(DataPacket *packet, const uint8_t *buffer, size_t len);
+#endif /* DATA_PUBLISHER_H */
@@ -7,14 +7,83 @@
  */
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
 
+#include "attitude-predictor.h"
 #include "data-source.h"
+#include "flight-recorder.h"
 #include "misc.h"
+#include "perf-counters.h"
 
 static DataSource *_datasource = NULL;
+/* Source whose acquisition thread is the current one, if any: setters
+ * called from there only stage the values for the rendering thread*/
+static __thread DataSource *_acquiring = NULL;
+
+#if ENABLE_PERF_COUNTERS
+static const char *listener_scopes[N_VALUE_TYPES] = {
+    [LOCATION_DATA] = "location",
+    [ATTITUDE_DATA] = "attitude",
+    [DYNAMICS_DATA] = "dynamics",
+    [ENGINE_DATA] = "engine_data",
+    [ROUTE_DATA] = "route"
+};
+#endif
+
+#define LISTENERS_ALLOC_CHUNK 4
+#define NLISTENERS(self, type) ((self)->listener_start[(type)+1] - (self)->listener_start[(type)])
+
+/*Where each type of value goes in DataFrame*/
+#define FRAME_FIELD(member) {offsetof(DataFrame, member), sizeof(((DataFrame*)0)->member)}
+static const struct{
+    size_t offset;
+    size_t size;
+}frame_fields[N_VALUE_TYPES] = {
+    [LOCATION_DATA] = FRAME_FIELD(location),
+    [ATTITUDE_DATA] = FRAME_FIELD(attitude),
+    [DYNAMICS_DATA] = FRAME_FIELD(dynamics),
+    [ENGINE_DATA] = FRAME_FIELD(engine_data),
+    [ROUTE_DATA] = FRAME_FIELD(route)
+};
+
+/* Below what the gauges can show anyway: 0.05° of attitude, 1 rpm, about
+ * 10cm of position, etc.*/
+const DataFrame data_source_display_deadbands = {
+    .location = {
+        .super.latitude = 1e-6,
+        .super.longitude = 1e-6,
+        .altitude = 0.5
+    },
+    .attitude = {
+        .roll = 0.05,
+        .pitch = 0.05,
+        .heading = 0.05
+    },
+    .dynamics = {
+        .airspeed = 0.1,
+        .vertical_speed = 0.05, /*3 ft/min*/
+        .slip_rad = 0.001,
+        .groundspeed = 0.1,
+        .track = 0.1
+    },
+    .engine_data = {
+        .rpm = 1,
+        .fuel_flow = 0.01,
+        .fuel_px = 0.01,
+        .oil_temp = 0.1,
+        .oil_press = 0.1,
+        .cht = 0.5,
+        .fuel_qty = 0.01,
+        .egt = 0.5,
+        .man_press = 0.01,
+        .volts = 0.01
+    }
+};
 
 /*forward declarations of private functions*/
-static bool get_listener_range(DataType type, uintf8_t *start, uintf8_t *limit);
+static void *data_source_worker(DataSource *self);
 
 
 DataSource *data_source_get_instance(void)
@@ -58,26 +127,224 @@ size_t data_source_add_events_listener(DataSource *self, void *target,
     return i;
 }
 
+/**
+ * @brief Registers @p listener to be called when a value of type @p type
+ * changes. Listeners are called by decreasing priority, then in
+ * registration order.
+ *
+ * Not to be called from a listener.
+ *
+ * @param listener callback, target, and optionally priority and period.
+ * It is copied.
+ * @return true on success, false otherwise
+ */
 bool data_source_add_listener(DataSource *self, DataType type, ValueListener *listener)
 {
-    uintf8_t idx, limit;
+    size_t idx, nlisteners;
 
     self = self ? self : data_source_get_instance();
 
-    get_listener_range(type, &idx, &limit);
-    if(self->nlisteners[type] == limit){
-        printf(
-            "Tried to add another location listener while %d limit has been reached."
-            "Please increment the corresponding listeners limit\n", limit
-        );
+    if(type >= N_VALUE_TYPES){
+        printf("CRIT: %s: bad type %d\n",__FUNCTION__, type);
         return false;
     }
-    self->listeners[idx+self->nlisteners[type]] = *listener;
-    self->nlisteners[type]++;
 
+    nlisteners = self->listener_start[N_VALUE_TYPES];
+    if(nlisteners == self->listeners_size){
+        void *tmp;
+        self->listeners_size += LISTENERS_ALLOC_CHUNK;
+        tmp = realloc(self->listeners, sizeof(ValueListener)*self->listeners_size);
+        if(!tmp){
+            self->listeners_size -= LISTENERS_ALLOC_CHUNK;
+            return false;
+        }
+        self->listeners = tmp;
+    }
+
+    idx = self->listener_start[type];
+    while(idx < self->listener_start[type+1] && self->listeners[idx].priority >= listener->priority)
+        idx++;
+    memmove(&self->listeners[idx+1], &self->listeners[idx], (nlisteners - idx) * sizeof(ValueListener));
+    self->listeners[idx] = *listener;
+    self->listeners[idx].next = 0;
+    self->listeners[idx].pending = false;
+
+    for(int i = type+1; i <= N_VALUE_TYPES; i++)
+        self->listener_start[i]++;
     return true;
 }
 
+/**
+ * @brief Registers a listener that gets, once per frame, everything that
+ * changed during that frame instead of one call per value. Listeners are
+ * called by decreasing priority, then in registration order.
+ *
+ * Not to be called from a listener.
+ *
+ * @param listener callback, target, mask (DATA_CHANGED bits of the values
+ * the listener must be called for, ALL_DATA_CHANGED for all of them) and
+ * optionally priority and period. It is copied.
+ * @return true on success, false otherwise
+ */
+bool data_source_add_frame_listener(DataSource *self, FrameListener *listener)
+{
+    size_t idx;
+
+    self = self ? self : data_source_get_instance();
+
+    if(self->nframe_listeners == self->frame_listeners_size){
+        void *tmp;
+        self->frame_listeners_size += LISTENERS_ALLOC_CHUNK;
+        tmp = realloc(self->frame_listeners, sizeof(FrameListener)*self->frame_listeners_size);
+        if(!tmp){
+            self->frame_listeners_size -= LISTENERS_ALLOC_CHUNK;
+            return false;
+        }
+        self->frame_listeners = tmp;
+    }
+
+    idx = 0;
+    while(idx < self->nframe_listeners && self->frame_listeners[idx].priority >= listener->priority)
+        idx++;
+    memmove(&self->frame_listeners[idx+1], &self->frame_listeners[idx],
+        (self->nframe_listeners - idx) * sizeof(FrameListener)
+    );
+    self->frame_listeners[idx] = *listener;
+    self->frame_listeners[idx].next = 0;
+    self->frame_listeners[idx].pending = 0;
+    self->nframe_listeners++;
+    return true;
+}
+
+static void data_source_remove_listener_at(DataSource *self, DataType type, size_t idx)
+{
+    memmove(&self->listeners[idx], &self->listeners[idx+1],
+        (self->listener_start[N_VALUE_TYPES] - idx - 1) * sizeof(ValueListener)
+    );
+    for(int i = type+1; i <= N_VALUE_TYPES; i++)
+        self->listener_start[i]--;
+}
+
+static void data_source_remove_frame_listener_at(DataSource *self, size_t idx)
+{
+    memmove(&self->frame_listeners[idx], &self->frame_listeners[idx+1],
+        (self->nframe_listeners - idx - 1) * sizeof(FrameListener)
+    );
+    self->nframe_listeners--;
+}
+
+/**
+ * @brief Unregisters a listener added with data_source_add_listener. Not
+ * to be called from a listener.
+ *
+ * @return true if the listener was found and removed, false otherwise
+ */
+bool data_source_remove_listener(DataSource *self, DataType type, void *target, ValueListenerFunc callback)
+{
+    self = self ? self : data_source_get_instance();
+
+    if(type >= N_VALUE_TYPES)
+        return false;
+    for(size_t i = self->listener_start[type]; i < self->listener_start[type+1]; i++){
+        if(self->listeners[i].target == target && self->listeners[i].callback == callback){
+            data_source_remove_listener_at(self, type, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Unregisters a listener added with data_source_add_frame_listener.
+ * Not to be called from a listener.
+ *
+ * @return true if the listener was found and removed, false otherwise
+ */
+bool data_source_remove_frame_listener(DataSource *self, void *target, FrameListenerFunc callback)
+{
+    self = self ? self : data_source_get_instance();
+
+    for(size_t i = 0; i < self->nframe_listeners; i++){
+        if(self->frame_listeners[i].target == target && self->frame_listeners[i].callback == callback){
+            data_source_remove_frame_listener_at(self, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Unregisters all listeners of @p target, e.g. before freeing it.
+ * Not to be called from a listener.
+ *
+ * @param target Object whose listeners must go, NULL to remove all
+ * listeners and release their storage
+ * @return The number of listeners removed
+ */
+size_t data_source_remove_listeners(DataSource *self, void *target)
+{
+    size_t rv;
+
+    self = self ? self : data_source_get_instance();
+
+    if(!target){
+        rv = self->listener_start[N_VALUE_TYPES] + self->nframe_listeners;
+        free(self->listeners);
+        free(self->frame_listeners);
+        self->listeners = NULL;
+        self->frame_listeners = NULL;
+        self->listeners_size = self->frame_listeners_size = 0;
+        self->nframe_listeners = 0;
+        memset(self->listener_start, 0, sizeof(self->listener_start));
+        return rv;
+    }
+
+    rv = 0;
+    for(int type = N_VALUE_TYPES - 1; type >= 0; type--){
+        for(size_t i = self->listener_start[type+1]; i > self->listener_start[type]; i--){
+            if(self->listeners[i-1].target == target){
+                data_source_remove_listener_at(self, type, i-1);
+                rv++;
+            }
+        }
+    }
+    for(size_t i = self->nframe_listeners; i > 0; i--){
+        if(self->frame_listeners[i-1].target == target){
+            data_source_remove_frame_listener_at(self, i-1);
+            rv++;
+        }
+    }
+    return rv;
+}
+
+/*Rate limiting: whether a listener can be called at @p now*/
+static inline bool listener_due(uint32_t period, uint64_t *next, uint64_t now)
+{
+    if(now < *next)
+        return false;
+    *next = now + (uint64_t)period * 1000000;
+    return true;
+}
+
+/**
+ * @brief Sets, per field, the smallest change that gets handed over to
+ * listeners. A value is compared to the one listeners last got, not to
+ * the previous sample: noise within the band never fires listeners, and
+ * a value sitting on the edge of it doesn't flicker back and forth.
+ * When any field moves out of its band, the whole value is handed over.
+ *
+ * Recording isn't affected: it still gets every new value.
+ *
+ * @param deadbands Float fields are the bands, in the units of the
+ * values; everything else is ignored. All zeros (the default) fires
+ * listeners on any change. data_source_display_deadbands holds bands
+ * that are invisible on the gauges.
+ */
+void data_source_set_deadbands(DataSource *self, const DataFrame *deadbands)
+{
+    self = self ? self : data_source_get_instance();
+    self->deadbands = *deadbands;
+}
 
 void data_source_print_listener_stats(DataSource *self)
 {
@@ -87,60 +354,132 @@ void data_source_print_listener_stats(DataSource *self)
         "\tattitude: %zu\n"
         "\tdynamics: %zu\n"
         "\tengine data: %zu\n"
-        "\troute: %zu\n",
-        self->nlisteners[LOCATION_DATA],
-        self->nlisteners[ATTITUDE_DATA],
-        self->nlisteners[DYNAMICS_DATA],
-        self->nlisteners[ENGINE_DATA],
-        self->nlisteners[ROUTE_DATA]
+        "\troute: %zu\n"
+        "\tframe: %zu\n",
+        NLISTENERS(self, LOCATION_DATA),
+        NLISTENERS(self, ATTITUDE_DATA),
+        NLISTENERS(self, DYNAMICS_DATA),
+        NLISTENERS(self, ENGINE_DATA),
+        NLISTENERS(self, ROUTE_DATA),
+        self->nframe_listeners
     );
 }
 
-static void data_source_fire_listeners(DataSource *self, DataType type, void *param)
+static void data_source_fire_listeners(DataSource *self, DataType type, void *param, uint64_t timestamp)
 {
-    uintf8_t idx, limit;
+    ValueListener *listener;
+    uint64_t now = 0;
 
     self = self ? self : data_source_get_instance();
 
-    get_listener_range(type, &idx, &limit);
-    for(int i = idx; i < idx + self->nlisteners[type]; i++){
-        self->listeners[i].callback(
-            self->listeners[i].target,
-            param
-        );
+    if(timestamp && (!self->undisplayed || timestamp < self->undisplayed))
+        self->undisplayed = timestamp;
+
+    /*Frame listeners get it along with the rest at the end of the frame*/
+    memcpy((uint8_t*)&self->frame + frame_fields[type].offset, param, frame_fields[type].size);
+    self->changed |= DATA_CHANGED(type);
+
+    if(self->listener_start[type] == self->listener_start[type+1])
+        return;
+    PERF_BEGIN("listeners");
+    PERF_BEGIN(listener_scopes[type]);
+    for(size_t i = self->listener_start[type]; i < self->listener_start[type+1]; i++){
+        listener = &self->listeners[i];
+        if(listener->period){
+            now = now ? now : monotonic_ns();
+            if(!listener_due(listener->period, &listener->next, now)){
+                /*data_source_dispatch_frame will hand it the latest value*/
+                listener->pending = true;
+                self->held_back = true;
+                continue;
+            }
+            listener->pending = false;
+        }
+        listener->callback(listener->target, param);
     }
+    PERF_END();
+    PERF_END();
 }
 
 void data_source_set_location(DataSource *self, LocationData *location)
 {
     self = self ? self : data_source_get_instance();
 
-    if(location_equals(location, &self->location))
+    if(!location->timestamp)
+        location->timestamp = monotonic_ns();
+
+    if(_acquiring == self){
+        if(self->recorder && !location_equals(location, &self->worker->staging.location))
+            flight_recorder_push(self->recorder, LOCATION_DATA, location);
+        self->worker->staging.location = *location;
         return;
+    }
 
-    data_source_fire_listeners(self, LOCATION_DATA, location);
+    if(location_equals(location, &self->location))
+        return;
+    if(self->recorder && !self->worker)
+        flight_recorder_push(self->recorder, LOCATION_DATA, location);
     self->location = *location;
+
+    if(location_within(location, &self->frame.location, &self->deadbands.location))
+        return;
+    data_source_fire_listeners(self, LOCATION_DATA, location, location->timestamp);
 }
 
 void data_source_set_attitude(DataSource *self, AttitudeData *attitude)
 {
     self = self ? self : data_source_get_instance();
 
+    if(!attitude->timestamp)
+        attitude->timestamp = monotonic_ns();
+
+    if(_acquiring == self){
+        if(self->recorder && !attitude_equals(attitude, &self->worker->staging.attitude))
+            flight_recorder_push(self->recorder, ATTITUDE_DATA, attitude);
+        self->worker->staging.attitude = *attitude;
+        return;
+    }
+
     if(attitude_equals(attitude, &self->attitude))
         return;
+    if(self->recorder && !self->worker)
+        flight_recorder_push(self->recorder, ATTITUDE_DATA, attitude);
 
-    data_source_fire_listeners(self, ATTITUDE_DATA, attitude);
     self->attitude = *attitude;
+
+    if(self->predictor){
+        /*Listeners will get the extrapolated value at the next frame*/
+        attitude_predictor_add_sample(self->predictor, attitude);
+        return;
+    }
+    if(attitude_within(attitude, &self->frame.attitude, &self->deadbands.attitude))
+        return;
+    data_source_fire_listeners(self, ATTITUDE_DATA, attitude, attitude->timestamp);
 }
 
 void data_source_set_dynamics(DataSource *self, DynamicsData *dynamics)
 {
     self = self ? self : data_source_get_instance();
 
+    if(!dynamics->timestamp)
+        dynamics->timestamp = monotonic_ns();
+
+    if(_acquiring == self){
+        if(self->recorder && !dynamics_equals(dynamics, &self->worker->staging.dynamics))
+            flight_recorder_push(self->recorder, DYNAMICS_DATA, dynamics);
+        self->worker->staging.dynamics = *dynamics;
+        return;
+    }
+
     if(dynamics_equals(dynamics, &self->dynamics))
         return;
-    data_source_fire_listeners(self, DYNAMICS_DATA, dynamics);
+    if(self->recorder && !self->worker)
+        flight_recorder_push(self->recorder, DYNAMICS_DATA, dynamics);
     self->dynamics = *dynamics;
+
+    if(dynamics_within(dynamics, &self->frame.dynamics, &self->deadbands.dynamics))
+        return;
+    data_source_fire_listeners(self, DYNAMICS_DATA, dynamics, dynamics->timestamp);
 }
 
 
@@ -148,52 +487,319 @@ void data_source_set_engine_data(DataSource *self, EngineData *engine_data)
 {
     self = self ? self : data_source_get_instance();
 
+    if(!engine_data->timestamp)
+        engine_data->timestamp = monotonic_ns();
+
+    if(_acquiring == self){
+        if(self->recorder && !engine_data_equals(engine_data, &self->worker->staging.engine_data))
+            flight_recorder_push(self->recorder, ENGINE_DATA, engine_data);
+        self->worker->staging.engine_data = *engine_data;
+        return;
+    }
+
     if(engine_data_equals(engine_data, &self->engine_data))
         return;
-    data_source_fire_listeners(self, ENGINE_DATA, engine_data);
+    if(self->recorder && !self->worker)
+        flight_recorder_push(self->recorder, ENGINE_DATA, engine_data);
     self->engine_data = *engine_data;
+
+    if(engine_data_within(engine_data, &self->frame.engine_data, &self->deadbands.engine_data))
+        return;
+    data_source_fire_listeners(self, ENGINE_DATA, engine_data, engine_data->timestamp);
 }
 
 void data_source_set_route_data(DataSource *self, RouteData *route_data)
 {
     self = self ? self : data_source_get_instance();
 
+    if(!route_data->timestamp)
+        route_data->timestamp = monotonic_ns();
+
     if(route_data_equals(route_data, &self->route))
         return;
-    data_source_fire_listeners(self, ROUTE_DATA, route_data);
+    data_source_fire_listeners(self, ROUTE_DATA, route_data, route_data->timestamp);
     self->route = *route_data;
 }
 
+/**
+ * @brief Records that the source got its first valid data. Goes through
+ * the snapshot when called from the acquisition thread so that the
+ * rendering thread doesn't see has_fix before the values themselves.
+ */
+void data_source_set_fix(DataSource *self)
+{
+    self = self ? self : data_source_get_instance();
 
-static bool get_listener_range(DataType type, uintf8_t *start, uintf8_t *limit)
+    if(_acquiring == self){
+        self->worker->staging.has_fix = true;
+        return;
+    }
+    atomic_store(&self->has_fix, true);
+}
+
+
+/**
+ * @brief Hands over to frame listeners everything that changed since the
+ * previous call: each one is called once, whatever the number of values
+ * that changed. Called at the end of data_source_frame, to be called
+ * explicitly when values are set directly with the data_source_set_*
+ * functions instead.
+ */
+void data_source_dispatch_frame(DataSource *self)
 {
-    switch(type){
-        case LOCATION_DATA:
-            *start = 0;
-            *limit = *start + MAX_LOCATION_LISTENERS;
-            return true;
-        case ATTITUDE_DATA:
-            *start = MAX_LOCATION_LISTENERS;
-            *limit = *start + MAX_ATTITUDE_LISTENERS;
-            return true;
-        case DYNAMICS_DATA:
-            *start = MAX_LOCATION_LISTENERS+MAX_ATTITUDE_LISTENERS;
-            *limit = *start + MAX_DYNAMICS_LISTENERS;
-            return true;
-        case ENGINE_DATA:
-            *start = MAX_LOCATION_LISTENERS+MAX_ATTITUDE_LISTENERS+MAX_DYNAMICS_LISTENERS;
-            *limit = *start + MAX_ENGINE_DATA_LISTENERS;
-            return true;
-        case ROUTE_DATA:
-            *start =  MAX_LOCATION_LISTENERS+MAX_ATTITUDE_LISTENERS
-                    + MAX_DYNAMICS_LISTENERS + MAX_ENGINE_DATA_LISTENERS;
-            *limit = *start + MAX_ROUTE_DATA_LISTENERS;
-            return true;
-        break;
-        default:
-            printf("CRIT: %s: bad type, problems ahead!\n",__FUNCTION__);
-            return 0;
-        break;
+    ValueListener *listener;
+    FrameListener *flistener;
+    uint32_t changed, bits;
+    uint64_t now;
+    bool held_back;
+
+    if(!self->changed && !self->held_back)
+        return;
+    changed = self->changed;
+    self->changed = 0;
+    now = 0;
+    held_back = false;
+
+    PERF_BEGIN("listeners");
+    if(self->held_back){
+        /*Value listeners that skipped a change get the latest value*/
+        now = monotonic_ns();
+        for(int type = 0; type < N_VALUE_TYPES; type++){
+            for(size_t i = self->listener_start[type]; i < self->listener_start[type+1]; i++){
+                listener = &self->listeners[i];
+                if(!listener->pending)
+                    continue;
+                if(!listener_due(listener->period, &listener->next, now)){
+                    held_back = true;
+                    continue;
+                }
+                listener->pending = false;
+                listener->callback(listener->target,
+                    (uint8_t*)&self->frame + frame_fields[type].offset
+                );
+            }
+        }
+    }
+
+    PERF_BEGIN("frame");
+    for(size_t i = 0; i < self->nframe_listeners; i++){
+        flistener = &self->frame_listeners[i];
+        bits = (changed | flistener->pending) & flistener->mask;
+        if(!bits)
+            continue;
+        if(flistener->period){
+            now = now ? now : monotonic_ns();
+            if(!listener_due(flistener->period, &flistener->next, now)){
+                flistener->pending = bits;
+                held_back = true;
+                continue;
+            }
+            flistener->pending = 0;
+        }
+        flistener->callback(flistener->target, bits, &self->frame);
+    }
+    PERF_END();
+    PERF_END();
+    self->held_back = held_back;
+}
+
+/**
+ * @brief Tells that whatever has been handed to the listeners so far
+ * is now on screen. To be called right after presenting a frame.
+ *
+ * @return The acquisition time of the oldest sample that made it to
+ * the screen with this frame, 0 if there was no new sample. Its age is
+ * the glass-to-glass latency of that frame.
+ */
+uint64_t data_source_displayed(DataSource *self)
+{
+    uint64_t rv;
+
+    rv = self->undisplayed;
+    self->undisplayed = 0;
+    return rv;
+}
+
+/**
+ * @brief Puts a predictor between the attitude samples and the
+ * listeners: instead of getting the (possibly few and far between)
+ * samples, listeners get each frame the attitude extrapolated to the
+ * current time from the recent roll/pitch/heading rates.
+ *
+ * self->attitude keeps holding the last actual sample.
+ *
+ * @param horizon Maximum extrapolation past the last sample, ms. 0
+ * disables prediction.
+ * @return true on success, false otherwise
+ */
+bool data_source_set_prediction(DataSource *self, uint32_t horizon)
+{
+    if(!horizon){
+        if(self->predictor){
+            free(self->predictor);
+            self->predictor = NULL;
+        }
+        return true;
+    }
+
+    if(!self->predictor){
+        self->predictor = malloc(sizeof(AttitudePredictor));
+        if(!self->predictor)
+            return false;
+    }
+    attitude_predictor_init(self->predictor, horizon);
+    return true;
+}
+
+/**
+ * @brief Hands over the extrapolated attitude to listeners, if it
+ * changed. Called from data_source_frame.
+ */
+void data_source_predict(DataSource *self)
+{
+    AttitudePredictor *predictor = self->predictor;
+    AttitudeData predicted;
+    bool fresh;
+
+    if(!attitude_predictor_predict(predictor, monotonic_ns(), &predicted))
+        return;
+    if(attitude_within(&predicted, &predictor->output, &self->deadbands.attitude))
+        return;
+
+    /*Only the first display of a sample counts for latency*/
+    fresh = predicted.timestamp != predictor->output.timestamp;
+    data_source_fire_listeners(self, ATTITUDE_DATA, &predicted, fresh ? predicted.timestamp : 0);
+    predictor->output = predicted;
+}
+
+/**
+ * @brief Records every new value the source delivers to a flight log
+ * (see flight-log.h), that FlightLogDataSource can replay. Values are
+ * recorded as acquired, before attitude prediction, from the thread that
+ * acquires them. Encoding and I/O are done in the background.
+ *
+ * To be called before data_source_start_acquisition.
+ *
+ * @param filename Log to (over)write, NULL stops recording
+ * @return true on success, false otherwise
+ */
+bool data_source_record(DataSource *self, const char *filename)
+{
+    if(self->recorder){
+        flight_recorder_free(self->recorder);
+        self->recorder = NULL;
+    }
+    if(!filename)
+        return true;
+
+    self->recorder = flight_recorder_new(filename);
+    return self->recorder != NULL;
+}
+
+/**
+ * @brief Moves the acquisition (i.e the DataSource frame function) to a
+ * dedicated thread that will call it every @p period ms. Values are then
+ * handed over to the rendering thread as whole snapshots, picked up by
+ * data_source_frame, so that I/O latency never stalls rendering.
+ *
+ * Sources are then expected not to touch anything but their own state
+ * and the data_source_set_* functions from their frame function.
+ *
+ * @param period Time to wait between two calls to the frame function, ms
+ * @return true on success, false otherwise. The source keeps being
+ * polled from data_source_frame in that case.
+ */
+bool data_source_start_acquisition(DataSource *self, uint32_t period)
+{
+    DataSourceWorker *worker;
+    int err;
+
+    if(self->worker)
+        return true;
+
+    worker = calloc(1, sizeof(DataSourceWorker));
+    if(!worker)
+        return false;
+    if(!triple_buffer_init(&worker->snapshots, sizeof(DataSnapshot))){
+        free(worker);
+        return false;
+    }
+    worker->period = period;
+    worker->staging = (DataSnapshot){
+        .location = self->location,
+        .attitude = self->attitude,
+        .dynamics = self->dynamics,
+        .engine_data = self->engine_data,
+        .has_fix = atomic_load(&self->has_fix)
     };
+    atomic_init(&worker->running, true);
+
+    self->worker = worker;
+    err = pthread_create(&worker->tid, NULL, (void*)data_source_worker, self);
+    if(err){
+        printf("%s: couldn't create acquisition thread: %s\n", __FUNCTION__, strerror(err));
+        self->worker = NULL;
+        triple_buffer_dispose(&worker->snapshots);
+        free(worker);
+        return false;
+    }
+    return true;
+}
+
+void data_source_stop_acquisition(DataSource *self)
+{
+    DataSourceWorker *worker = self->worker;
+
+    if(!worker)
+        return;
+    atomic_store(&worker->running, false);
+    pthread_join(worker->tid, NULL);
+
+    self->worker = NULL;
+    triple_buffer_dispose(&worker->snapshots);
+    free(worker);
+}
+
+/**
+ * @brief Applies the last snapshot published by the acquisition thread,
+ * firing listeners for the values that changed. Rendering thread only.
+ *
+ * @return true if a new snapshot was available
+ */
+bool data_source_consume(DataSource *self)
+{
+    DataSnapshot *snap;
+
+    snap = triple_buffer_consume(&self->worker->snapshots);
+    if(!snap)
+        return false;
+
+    data_source_set_location(self, &snap->location);
+    data_source_set_attitude(self, &snap->attitude);
+    data_source_set_dynamics(self, &snap->dynamics);
+    data_source_set_engine_data(self, &snap->engine_data);
+    if(snap->has_fix)
+        data_source_set_fix(self);
+    return true;
 }
 
+static void *data_source_worker(DataSource *self)
+{
+    DataSourceWorker *worker = self->worker;
+    uint64_t now, last;
+
+    _acquiring = self;
+    last = monotonic_ns();
+    while(atomic_load(&worker->running)){
+        now = monotonic_ns();
+        /*Same semantics as in the main loop: time since last successful frame*/
+        if(self->ops->frame(self, (now - last) / 1000000)){
+            last = now;
+            *(DataSnapshot*)triple_buffer_back(&worker->snapshots) = worker->staging;
+            triple_buffer_publish(&worker->snapshots);
+        }
+        usleep(worker->period * 1000);
+    }
+    _acquiring = NULL;
+    return NULL;
+}
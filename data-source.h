@@ -10,22 +10,16 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "geo-location.h"
-
-#define MAX_LOCATION_LISTENERS 3
-#define MAX_ATTITUDE_LISTENERS 3
-#define MAX_DYNAMICS_LISTENERS 1
-#define MAX_ENGINE_DATA_LISTENERS 1
-#define MAX_ROUTE_DATA_LISTENERS 2
-#define TOTAL_MAX_LISTENERS \
-          MAX_LOCATION_LISTENERS \
-        + MAX_ATTITUDE_LISTENERS \
-        + MAX_DYNAMICS_LISTENERS \
-        + MAX_ENGINE_DATA_LISTENERS \
-        + MAX_ROUTE_DATA_LISTENERS
+#include "triple-buffer.h"
 
 typedef struct _DataSource DataSource;
+typedef struct _AttitudePredictor AttitudePredictor;
+typedef struct _FlightRecorder FlightRecorder;
 typedef bool (*DataSourceFrameFunc)(DataSource *self, uint32_t dt);
 typedef DataSource *(*DataSourceDisposeFunc)(DataSource *self);
 
@@ -41,6 +35,15 @@ typedef void (*ValueListenerFunc)(void *self, const void *newvalue);
 typedef struct{
     ValueListenerFunc callback;
     void *target;
+    int priority; /*Higher first, registration order among equals*/
+    /* Minimum time between two calls, ms. Changes in between are not
+     * lost: the latest value is handed over once the time has come. 0
+     * for every change*/
+    uint32_t period;
+
+    /*Private*/
+    uint64_t next; /*monotonic_ns() of the next allowed call*/
+    bool pending; /*A change has been held back*/
 }ValueListener;
 
 typedef enum{
@@ -56,12 +59,19 @@ typedef struct{
     float roll;
     float pitch;
     float heading;
+    uint64_t timestamp; /*monotonic_ns() at acquisition, see data_source_set_*/
+    /* Extrapolated rather than measured, already updated each frame: no
+     * need to animate the transition*/
+    bool predicted;
 }AttitudeData;
 
 typedef struct{
     float airspeed; //kts
     float vertical_speed; //vertical speed //feets per second
     float slip_rad;
+    float groundspeed; /*kts*/
+    float track; /*degrees true*/
+    uint64_t timestamp; /*monotonic_ns() at acquisition, see data_source_set_*/
 }DynamicsData;
 
 typedef struct{
@@ -72,18 +82,72 @@ typedef struct{
     float oil_press;
     float cht;
     float fuel_qty;
+    /*Not every source has these, NAN when unknown*/
+    float egt;
+    float man_press; /*inHg*/
+    float volts;
+    uint64_t timestamp; /*monotonic_ns() at acquisition, see data_source_set_*/
 }EngineData;
 
 typedef struct{
     GeoLocation super;
     float altitude;
+    uint64_t timestamp; /*monotonic_ns() at acquisition, see data_source_set_*/
 }LocationData;
 
 typedef struct{
     GeoLocation to;
     GeoLocation from;
+    uint64_t timestamp; /*monotonic_ns() at acquisition, see data_source_set_*/
 }RouteData;
 
+/*What the acquisition thread hands over to the rendering one*/
+typedef struct{
+    LocationData location;
+    AttitudeData attitude;
+    DynamicsData dynamics;
+    EngineData engine_data;
+    bool has_fix;
+}DataSnapshot;
+
+/*Everything listeners have been handed so far, see FrameListener*/
+typedef struct{
+    LocationData location;
+    AttitudeData attitude;
+    DynamicsData dynamics;
+    EngineData engine_data;
+    RouteData route;
+}DataFrame;
+
+/*Bit of a DataType in FrameListener masks*/
+#define DATA_CHANGED(type) (1 << (type))
+#define ALL_DATA_CHANGED (DATA_CHANGED(N_VALUE_TYPES) - 1)
+
+/* Called at most once per frame, after all values have been set, with
+ * the DATA_CHANGED bits of what changed since the previous call. Fields
+ * not in @p changed are the last values handed over.*/
+typedef void (*FrameListenerFunc)(void *self, uint32_t changed, const DataFrame *frame);
+typedef struct{
+    FrameListenerFunc callback;
+    void *target;
+    uint32_t mask; /*DATA_CHANGED bits the listener cares about*/
+    int priority; /*See ValueListener*/
+    uint32_t period; /*See ValueListener*/
+
+    /*Private*/
+    uint64_t next;
+    uint32_t pending; /*DATA_CHANGED bits held back*/
+}FrameListener;
+
+typedef struct{
+    pthread_t tid;
+    atomic_bool running;
+    uint32_t period; /*ms*/
+
+    DataSnapshot staging; /*Acquisition thread only*/
+    TripleBuffer snapshots;
+}DataSourceWorker;
+
 typedef struct _DataSource{
     DataSourceOps *ops;
 
@@ -93,34 +157,78 @@ typedef struct _DataSource{
     EngineData engine_data;
     RouteData route;
 
-    /* We want to avoid dynamic allocation for these.
-     * Thus the adding functio will emit a warning at runtime if the values are
-     * exceeded to let the developper know that the value should be
-     * incremented.
-     * The number of listeners is known at compile-time and won't change at
-     * runtime
+    /* All value listeners in a single array, grouped by type, by
+     * decreasing priority within a type. Listeners of type t are
+     * listeners[listener_start[t]] to listeners[listener_start[t+1]-1].
+     * Only (un)registering allocates, dispatch just walks the array.
      */
-    ValueListener listeners[TOTAL_MAX_LISTENERS];
-    size_t nlisteners[N_VALUE_TYPES];
+    ValueListener *listeners;
+    size_t listener_start[N_VALUE_TYPES+1];
+    size_t listeners_size; /*allocated listeners*/
 
-    bool has_fix;
+    /* Listeners that want all the changes of a frame at once rather than
+     * one call per value, by decreasing priority, see
+     * data_source_dispatch_frame*/
+    FrameListener *frame_listeners;
+    size_t nframe_listeners;
+    size_t frame_listeners_size; /*allocated frame listeners*/
+    DataFrame frame;
+    uint32_t changed; /*DATA_CHANGED bits, not yet dispatched*/
+    bool held_back; /*A rate-limited listener is waiting for its turn*/
+
+    /* Per field, how much a value must move away from what listeners
+     * last got before they get it again, see data_source_set_deadbands*/
+    DataFrame deadbands;
+
+    /* Set from the acquisition thread when there is one, only
+     * ever goes from false to true*/
+    atomic_bool has_fix;
+
+    /* Acquisition time of the oldest sample handed to listeners since
+     * the last call to data_source_displayed, 0 if none*/
+    uint64_t undisplayed;
+
+    DataSourceWorker *worker;
+    AttitudePredictor *predictor; /*See data_source_set_prediction*/
+    FlightRecorder *recorder; /*See data_source_record*/
 }DataSource;
 
 #define DATA_SOURCE(self) ((DataSource*)self)
 
+extern const DataFrame data_source_display_deadbands;
+
 DataSource *data_source_get_instance(void);
 void data_source_set(DataSource *source);
 
 bool data_source_add_listener(DataSource *self, DataType type, ValueListener *listener);
 size_t data_source_add_events_listener(DataSource *self, void *target,
                                            size_t nevents, ...);
+bool data_source_add_frame_listener(DataSource *self, FrameListener *listener);
+bool data_source_remove_listener(DataSource *self, DataType type, void *target, ValueListenerFunc callback);
+bool data_source_remove_frame_listener(DataSource *self, void *target, FrameListenerFunc callback);
+size_t data_source_remove_listeners(DataSource *self, void *target);
 void data_source_print_listener_stats(DataSource *self);
 
+void data_source_set_deadbands(DataSource *self, const DataFrame *deadbands);
+
 void data_source_set_location(DataSource *self, LocationData *location);
 void data_source_set_attitude(DataSource *self, AttitudeData *attitude);
 void data_source_set_dynamics(DataSource *self, DynamicsData *dynamics);
 void data_source_set_engine_data(DataSource *self, EngineData *engine_data);
 void data_source_set_route_data(DataSource *self, RouteData *route_data);
+void data_source_set_fix(DataSource *self);
+
+void data_source_dispatch_frame(DataSource *self);
+uint64_t data_source_displayed(DataSource *self);
+
+bool data_source_set_prediction(DataSource *self, uint32_t horizon);
+void data_source_predict(DataSource *self);
+
+bool data_source_record(DataSource *self, const char *filename);
+
+bool data_source_start_acquisition(DataSource *self, uint32_t period);
+void data_source_stop_acquisition(DataSource *self);
+bool data_source_consume(DataSource *self);
 
 static inline DataSource *data_source_init(DataSource *self, DataSourceOps *ops)
 {
@@ -130,15 +238,40 @@ static inline DataSource *data_source_init(DataSource *self, DataSourceOps *ops)
 
 static inline DataSource *data_source_dispose(DataSource *self)
 {
+    /*Subclasses resources must not go away under the worker's feet*/
+    data_source_stop_acquisition(self);
+    data_source_set_prediction(self, 0);
+    data_source_record(self, NULL);
+    data_source_remove_listeners(self, NULL);
     if(self->ops->dispose)
         return self->ops->dispose(self);
     return self;
 }
 
 
+/**
+ * @brief Updates the source values, firing the listeners of whatever
+ * changed. To be called from the rendering thread, once per frame.
+ *
+ * When acquisition runs on its own thread, this only picks up the latest
+ * values published by that thread and @p dt is ignored.
+ *
+ * @return true if values have been updated
+ */
 static inline bool data_source_frame(DataSource *self, uint32_t dt)
 {
-    return self->ops->frame(self, dt);
+    bool rv;
+
+    if(self->worker)
+        rv = data_source_consume(self);
+    else
+        rv = self->ops->frame(self, dt);
+    /* Doesn't count as an update: the return value is used to pace
+     * the source, not the display*/
+    if(self->predictor)
+        data_source_predict(self);
+    data_source_dispatch_frame(self);
+    return rv;
 }
 
 static inline DataSource *data_source_free(DataSource *self)
@@ -165,9 +298,14 @@ static inline bool dynamics_equals(DynamicsData *a, DynamicsData *b)
 {
     return   (a->airspeed == b->airspeed)
           && (a->vertical_speed == b->vertical_speed)
-          && (a->slip_rad == b->slip_rad);
+          && (a->slip_rad == b->slip_rad)
+          && (a->groundspeed == b->groundspeed)
+          && (a->track == b->track);
 }
 
+/*Unknown (NAN) values are equal to each other*/
+#define FIELD_EQUALS(a, b, field) ((a)->field == (b)->field || (isnan((a)->field) && isnan((b)->field)))
+
 static inline bool engine_data_equals(EngineData *a, EngineData *b)
 {
     return   (a->rpm == b->rpm)
@@ -176,7 +314,51 @@ static inline bool engine_data_equals(EngineData *a, EngineData *b)
           && (a->oil_temp == b->oil_temp)
           && (a->oil_press == b->oil_press)
           && (a->cht == b->cht)
-          && (a->fuel_qty == b->fuel_qty);
+          && (a->fuel_qty == b->fuel_qty)
+          && FIELD_EQUALS(a, b, egt)
+          && FIELD_EQUALS(a, b, man_press)
+          && FIELD_EQUALS(a, b, volts);
+}
+
+/*|a - b| <= band for that field, two unknown (NAN) values being within*/
+#define FIELD_WITHIN(a, b, band, field) (fabs((a)->field - (b)->field) <= (band)->field \
+                                         || (isnan((a)->field) && isnan((b)->field)))
+
+static inline bool location_within(LocationData *a, LocationData *b, LocationData *band)
+{
+    return   FIELD_WITHIN(a, b, band, super.latitude)
+          && FIELD_WITHIN(a, b, band, super.longitude)
+          && FIELD_WITHIN(a, b, band, altitude);
+}
+
+static inline bool attitude_within(AttitudeData *a, AttitudeData *b, AttitudeData *band)
+{
+    return   FIELD_WITHIN(a, b, band, roll)
+          && FIELD_WITHIN(a, b, band, pitch)
+          && FIELD_WITHIN(a, b, band, heading);
+}
+
+static inline bool dynamics_within(DynamicsData *a, DynamicsData *b, DynamicsData *band)
+{
+    return   FIELD_WITHIN(a, b, band, airspeed)
+          && FIELD_WITHIN(a, b, band, vertical_speed)
+          && FIELD_WITHIN(a, b, band, slip_rad)
+          && FIELD_WITHIN(a, b, band, groundspeed)
+          && FIELD_WITHIN(a, b, band, track);
+}
+
+static inline bool engine_data_within(EngineData *a, EngineData *b, EngineData *band)
+{
+    return   FIELD_WITHIN(a, b, band, rpm)
+          && FIELD_WITHIN(a, b, band, fuel_flow)
+          && FIELD_WITHIN(a, b, band, fuel_px)
+          && FIELD_WITHIN(a, b, band, oil_temp)
+          && FIELD_WITHIN(a, b, band, oil_press)
+          && FIELD_WITHIN(a, b, band, cht)
+          && FIELD_WITHIN(a, b, band, fuel_qty)
+          && FIELD_WITHIN(a, b, band, egt)
+          && FIELD_WITHIN(a, b, band, man_press)
+          && FIELD_WITHIN(a, b, band, volts);
 }
 
 static inline bool route_data_equals(RouteData *a, RouteData *b)
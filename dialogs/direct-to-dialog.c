@@ -27,6 +27,7 @@ static void selection_changed(DirectToDialog *self, ListBox *sender);
 static void button_pressed(DirectToDialog *self, Button *sender);
 
 static BaseWidgetOps direct_to_dialog_ops = {
+   .super.name = "DirectToDialog",
    .super.render = (RenderFunc)direct_to_dialog_render,
    .super.update_state = (StateUpdateFunc)NULL,
    .super.dispose = (DisposeFunc)NULL,
@@ -22,6 +22,7 @@ static void elevator_gauge_render(ElevatorGauge *self, Uint32 dt, RenderContext
 static void elevator_gauge_update_state(ElevatorGauge *self, Uint32 dt);
 static void *elevator_gauge_dispose(ElevatorGauge *self);
 static BaseGaugeOps elevator_gauge_ops = {
+   .name = "ElevatorGauge",
    .render = (RenderFunc)elevator_gauge_render,
    .update_state = (StateUpdateFunc)elevator_gauge_update_state,
    .dispose = (DisposeFunc)elevator_gauge_dispose
@@ -92,6 +92,8 @@ void fg_data_source_banner(FGDataSource *self)
 
 static FGDataSource *fg_data_source_dispose(FGDataSource *self)
 {
+    if(self->stats.received)
+        udp_ingest_stats_print(&self->stats, "FGDataSource");
     if(self->fglink)
         flightgear_connector_free(self->fglink);
     return self;
@@ -99,10 +101,20 @@ static FGDataSource *fg_data_source_dispose(FGDataSource *self)
 
 static bool fg_data_source_frame(FGDataSource *self, uint32_t dt)
 {
-    FlightgearPacket packet;
+    FlightgearPacket packet, next;
     bool rv;
 
-    rv = flightgear_connector_get_packet(self->fglink, &packet);
+    /* Every packet carries the whole state: empty the socket and only
+     * keep the newest one. The connector (fg-io) owns the socket and the
+     * wire format, hence no batched UdpIngest here*/
+    rv = false;
+    while(flightgear_connector_get_packet(self->fglink, &next)){
+        if(rv)
+            self->stats.dropped++;
+        self->stats.received++;
+        packet = next;
+        rv = true;
+    }
     if(!rv)
         return false;
 
@@ -138,11 +150,14 @@ static bool fg_data_source_frame(FGDataSource *self, uint32_t dt)
             .oil_press = packet.oil_px,
             .cht = packet.cht,
             .fuel_px = packet.fuel_px,
-            .fuel_qty = packet.fuel_qty
+            .fuel_qty = packet.fuel_qty,
+            .egt = NAN, /*Not in the protocol*/
+            .man_press = NAN,
+            .volts = NAN
         }
     );
 
-    DATA_SOURCE(self)->has_fix = true;
+    data_source_set_fix(DATA_SOURCE(self));
 
     return true;
 }
@@ -10,12 +10,15 @@
 
 #include "data-source.h"
 #include "flightgear-connector.h"
+#include "udp-ingest.h"
 
 typedef struct{
     DataSource super;
 
     FlightgearConnector *fglink;
     int port;
+
+    UdpIngestStats stats;
 }FGDataSource;
 
 FGDataSource *fg_data_source_new(int port);
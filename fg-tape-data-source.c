@@ -7,35 +7,14 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "data-source.h"
 #include "fg-tape-data-source.h"
 
-/*private struct*/
-typedef struct{
-    double latitude;
-    double longitude;
-    double altitude;
-    float roll;
-    float pitch;
-    float heading;
-    float slip_rad;
-    float airspeed; //kts
-    float vertical_speed; //vertical speed //feets per second
-
-    float rpm;
-    float fuel_flow;
-    float oil_temp;
-    float oil_press;
-    float cht;
-    float fuel_px;
-    float fuel_qty;
-}TapeRecord;
-
-
-
 static bool fg_tape_data_source_frame(FGTapeDataSource *self, uint32_t dt);
 static FGTapeDataSource *fg_tape_data_source_dispose(FGTapeDataSource *self);
+static bool fg_tape_data_source_build_index(FGTapeDataSource *self);
 static DataSourceOps fg_tape_data_souce_ops = {
     .frame = (DataSourceFrameFunc)fg_tape_data_source_frame,
     .dispose = (DataSourceDisposeFunc)fg_tape_data_source_dispose
@@ -70,27 +49,17 @@ FGTapeDataSource *fg_tape_data_souce_init(FGTapeDataSource *self, char *filename
 //    fg_tape_dump(tape);
 //
     found = fg_tape_get_signals(self->tape, self->signals,
-        "/position[0]/latitude-deg[0]",
-        "/position[0]/longitude-deg[0]",
-        "/position[0]/altitude-ft[0]",
-        "/orientation[0]/roll-deg[0]",
-        "/orientation[0]/pitch-deg[0]",
-        "/orientation[0]/heading-deg[0]",
-        "/orientation[0]/side-slip-rad[0]",
-        "/velocities[0]/airspeed-kt[0]",
-	    "/velocities[0]/vertical-speed-fps[0]",
-        "/engines[0]/engine[0]/rpm[0]",
-        "/engines[0]/engine[0]/fuel-flow-gph[0]",
-        "/engines[0]/engine[0]/oil-temperature-degf[0]",
-        "/engines[0]/engine[0]/oil-pressure-psi[0]",
-        "/engines[0]/engine[0]/cht-degf[0]",
-        "/engines[0]/engine[0]/fuel-px-psi[0]",
-        "/consumables[0]/fuel[0]/tank[0]/level-gal_us[0]",
+        TAPE_RECORD_SIGNALS,
         NULL
     );
-    printf("TapeRecord: found %d out of %d signals\n",found, 16);
+    printf("TapeRecord: found %d out of %d signals\n",found, TAPE_RECORD_NSIGNALS);
+
+    if(!fg_tape_data_source_build_index(self))
+        return NULL;
+    printf("Tape: %.0fs, %zu records indexed\n", self->duration, self->nrecords);
 
-    self->position = start_pos * 1000; /*Starting position in the tape*/
+    self->speed = 1.0;
+    fg_tape_data_source_seek(self, start_pos); /*Starting position in the tape*/
     self->playing= true;
 
     return self;
@@ -100,25 +69,206 @@ static FGTapeDataSource *fg_tape_data_source_dispose(FGTapeDataSource *self)
 {
     if(self->tape)
         fg_tape_free(self->tape);
+    if(self->index)
+        free(self->index);
     return self;
 }
 
-static bool fg_tape_data_source_frame(FGTapeDataSource *self, uint32_t dt)
+/**
+ * @brief Decodes the whole tape, sampling it every FG_TAPE_INDEX_STEP ms
+ * until its end.
+ */
+static bool fg_tape_data_source_build_index(FGTapeDataSource *self)
 {
-    TapeRecord record;
+    size_t allocated = 0;
+    TapeRecord *tmp;
     int rv;
 
-    if(dt != 0 && dt < (1000/25)) //One update per 1/25 second
+    for(self->nrecords = 0; ; self->nrecords++){
+        if(self->nrecords == allocated){
+            allocated = allocated ? allocated * 2 : 1024;
+            tmp = realloc(self->index, allocated * sizeof(TapeRecord));
+            if(!tmp){
+                printf("%s: couldn't allocate the tape index\n", __FUNCTION__);
+                return false;
+            }
+            self->index = tmp;
+        }
+        rv = fg_tape_get_data_at(self->tape,
+            self->nrecords * FG_TAPE_INDEX_STEP / 1000.0,
+            TAPE_RECORD_NSIGNALS, self->signals, &self->index[self->nrecords]
+        );
+        if(rv <= 0)
+            break;
+    }
+    if(!self->nrecords){
+        printf("%s: empty tape (or couldn't read it)\n", __FUNCTION__);
         return false;
+    }
+    /*Don't keep room for 2x the records on long tapes*/
+    tmp = realloc(self->index, self->nrecords * sizeof(TapeRecord));
+    if(tmp)
+        self->index = tmp;
+    self->duration = (self->nrecords - 1) * FG_TAPE_INDEX_STEP / 1000.0;
+    return true;
+}
+
+static inline float lerpf(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+/*Through the shortest way, result in the same range as @p a*/
+static inline float lerp_angle(float a, float b, float t)
+{
+    float d;
+
+    d = fmodf(b - a + 540.0f, 360.0f) - 180.0f;
+    return a + d * t;
+}
+
+/**
+ * @brief Interpolates the tape at @p position, in constant time.
+ */
+static void fg_tape_data_source_sample(FGTapeDataSource *self, double position, TapeRecord *rec)
+{
+    TapeRecord *a, *b;
+    double idx;
+    size_t i;
+    float t;
 
-    if(!self->playing)
+    idx = position * 1000.0 / FG_TAPE_INDEX_STEP;
+    if(idx <= 0){
+        *rec = self->index[0];
+        return;
+    }
+    i = idx;
+    if(i >= self->nrecords - 1){
+        *rec = self->index[self->nrecords - 1];
+        return;
+    }
+    t = idx - i;
+    a = &self->index[i];
+    b = &self->index[i+1];
+
+    rec->latitude = a->latitude + (b->latitude - a->latitude) * t;
+    rec->longitude = a->longitude + (b->longitude - a->longitude) * t;
+    rec->altitude = a->altitude + (b->altitude - a->altitude) * t;
+    rec->roll = lerp_angle(a->roll, b->roll, t);
+    rec->pitch = lerpf(a->pitch, b->pitch, t);
+    rec->heading = fmodf(lerp_angle(a->heading, b->heading, t) + 360.0f, 360.0f);
+    rec->slip_rad = lerpf(a->slip_rad, b->slip_rad, t);
+    rec->airspeed = lerpf(a->airspeed, b->airspeed, t);
+    rec->vertical_speed = lerpf(a->vertical_speed, b->vertical_speed, t);
+    rec->rpm = lerpf(a->rpm, b->rpm, t);
+    rec->fuel_flow = lerpf(a->fuel_flow, b->fuel_flow, t);
+    rec->oil_temp = lerpf(a->oil_temp, b->oil_temp, t);
+    rec->oil_press = lerpf(a->oil_press, b->oil_press, t);
+    rec->cht = lerpf(a->cht, b->cht, t);
+    rec->fuel_px = lerpf(a->fuel_px, b->fuel_px, t);
+    rec->fuel_qty = lerpf(a->fuel_qty, b->fuel_qty, t);
+}
+
+/**
+ * @brief Moves to @p position (seconds from the start of the tape),
+ * clamped to the tape. Takes effect at the next frame, even when paused.
+ */
+void fg_tape_data_source_seek(FGTapeDataSource *self, double position)
+{
+    if(position < 0)
+        position = 0;
+    if(position > self->duration)
+        position = self->duration;
+    self->position = position;
+    self->ended = false;
+    self->seeked = true;
+}
+
+/**
+ * @brief Sets the playback speed: 1.0 is real time, 4.0 fast-forwards 4
+ * times faster, -2.0 rewinds twice as fast, etc.
+ */
+void fg_tape_data_source_set_speed(FGTapeDataSource *self, float speed)
+{
+    self->speed = speed;
+    if(speed < 0)
+        self->ended = false;
+}
+
+/**
+ * @brief Plays [@p start, @p end] (seconds) over and over, in either
+ * direction. end <= start stops looping.
+ */
+void fg_tape_data_source_set_loop(FGTapeDataSource *self, double start, double end)
+{
+    self->loop_start = (start < 0) ? 0 : start;
+    self->loop_end = (end > self->duration) ? self->duration : end;
+    if(self->loop_end > self->loop_start
+       && (self->position < self->loop_start || self->position > self->loop_end))
+    {
+        fg_tape_data_source_seek(self, self->loop_start);
+    }
+}
+
+/*Applies the elapsed @p dt ms at the current speed, minding loops and bounds*/
+static void fg_tape_data_source_advance(FGTapeDataSource *self, uint32_t dt)
+{
+    double len;
+
+    self->position += self->speed * dt / 1000.0;
+
+    len = self->loop_end - self->loop_start;
+    if(len > 0){
+        if(self->position > self->loop_end)
+            self->position = self->loop_start + fmod(self->position - self->loop_start, len);
+        else if(self->position < self->loop_start)
+            self->position = self->loop_end - fmod(self->loop_start - self->position, len);
+        return;
+    }
+
+    if(self->speed > 0 && self->position >= self->duration){
+        self->position = self->duration;
+        self->ended = true;
+    }else if(self->speed < 0 && self->position <= 0){
+        /*Rewound to the start: wait there*/
+        self->position = 0;
+        self->playing = false;
+    }else if(self->position < 0){
+        self->position = 0;
+    }else if(self->position > self->duration){
+        self->position = self->duration;
+    }
+}
+
+/**
+ * @brief Switches the tape to simulated time: every frame will advance
+ * by @p step ms regardless of the actual elapsed time, and without the
+ * usual 25Hz throttling. This makes replays reproducible, i.e for
+ * benchmarking.
+ *
+ * @param step Simulated ms per frame, 0 goes back to wall-clock pacing
+ */
+void fg_tape_data_source_set_fixed_step(FGTapeDataSource *self, uint32_t step)
+{
+    self->fixed_step = step;
+}
+
+static bool fg_tape_data_source_frame(FGTapeDataSource *self, uint32_t dt)
+{
+    TapeRecord record;
+
+    if(self->fixed_step)
+        dt = self->fixed_step;
+    else if(dt != 0 && dt < (1000/25)) //One update per 1/25 second
         return false;
 
-    self->position += dt;
-    rv = fg_tape_get_data_at(self->tape, self->position / 1000.0, 16, self->signals, &record);
-    if(rv <= 0)
-        return false; /*Error or end of tape*/
+    if(self->playing && !self->ended)
+        fg_tape_data_source_advance(self, dt);
+    else if(!self->seeked)
+        return false;
+    self->seeked = false;
 
+    fg_tape_data_source_sample(self, self->position, &record);
 
     data_source_set_location(
         DATA_SOURCE(self), &(LocationData){
@@ -152,11 +302,14 @@ static bool fg_tape_data_source_frame(FGTapeDataSource *self, uint32_t dt)
             .oil_press = record.oil_press, /*TODO: All to _px*/
             .cht = record.cht,
             .fuel_px = record.fuel_px,
-            .fuel_qty = record.fuel_qty
+            .fuel_qty = record.fuel_qty,
+            .egt = NAN, /*Not recorded*/
+            .man_press = NAN,
+            .volts = NAN
         }
     );
 
-    DATA_SOURCE(self)->has_fix = true;
+    data_source_set_fix(DATA_SOURCE(self));
 
     return true;
 }
@@ -13,18 +13,80 @@
 #include "data-source.h"
 #include "fg-tape.h"
 
+#define FG_TAPE_INDEX_STEP 50 /*ms between two indexed records*/
+
+/*Tape properties making a TapeRecord, in the same order*/
+#define TAPE_RECORD_SIGNALS \
+        "/position[0]/latitude-deg[0]", \
+        "/position[0]/longitude-deg[0]", \
+        "/position[0]/altitude-ft[0]", \
+        "/orientation[0]/roll-deg[0]", \
+        "/orientation[0]/pitch-deg[0]", \
+        "/orientation[0]/heading-deg[0]", \
+        "/orientation[0]/side-slip-rad[0]", \
+        "/velocities[0]/airspeed-kt[0]", \
+        "/velocities[0]/vertical-speed-fps[0]", \
+        "/engines[0]/engine[0]/rpm[0]", \
+        "/engines[0]/engine[0]/fuel-flow-gph[0]", \
+        "/engines[0]/engine[0]/oil-temperature-degf[0]", \
+        "/engines[0]/engine[0]/oil-pressure-psi[0]", \
+        "/engines[0]/engine[0]/cht-degf[0]", \
+        "/engines[0]/engine[0]/fuel-px-psi[0]", \
+        "/consumables[0]/fuel[0]/tank[0]/level-gal_us[0]"
+#define TAPE_RECORD_NSIGNALS 16
+
+typedef struct{
+    double latitude;
+    double longitude;
+    double altitude;
+    float roll;
+    float pitch;
+    float heading;
+    float slip_rad;
+    float airspeed; //kts
+    float vertical_speed; //vertical speed //feets per second
+
+    float rpm;
+    float fuel_flow;
+    float oil_temp;
+    float oil_press;
+    float cht;
+    float fuel_px;
+    float fuel_qty;
+}TapeRecord;
+
 typedef struct{
     DataSource super;
 
     FGTape *tape;
-    FGTapeSignal signals[16];
+    FGTapeSignal signals[TAPE_RECORD_NSIGNALS];
+
+    /* The tape decoded once at load time, one record every
+     * FG_TAPE_INDEX_STEP ms: playing or seeking only interpolates
+     * between two neighbour records*/
+    TapeRecord *index;
+    size_t nrecords;
+    double duration; /*s*/
 
-    uint32_t position;
+    double position; /*s*/
+    float speed; /*Playback speed multiplier, negative rewinds*/
+    double loop_start, loop_end; /*s, no loop when loop_end <= loop_start*/
     bool playing;
+    bool ended; /*Reached the end of the tape (or failed reading it)*/
+    bool seeked; /*Position changed, to be published even when paused*/
+
+    /* When non-zero, each frame advances the tape by exactly that
+     * many milliseconds regardless of the wall-clock dt*/
+    uint32_t fixed_step;
 }FGTapeDataSource;
 
 FGTapeDataSource *fg_tape_data_source_new(char *filename, int start_pos);
 FGTapeDataSource *fg_tape_data_souce_init(FGTapeDataSource *self, char *filename, int start_pos);
 
+void fg_tape_data_source_set_fixed_step(FGTapeDataSource *self, uint32_t step);
+void fg_tape_data_source_seek(FGTapeDataSource *self, double position);
+void fg_tape_data_source_set_speed(FGTapeDataSource *self, float speed);
+void fg_tape_data_source_set_loop(FGTapeDataSource *self, double start, double end);
+
 
 #endif /* FG_TAPE_DATA_SOURCE_H */
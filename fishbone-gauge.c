@@ -30,6 +30,7 @@ static void fishbone_gauge_render(FishboneGauge *self, Uint32 dt, RenderContext
 static void fishbone_gauge_update_state(FishboneGauge *self, Uint32 dt);
 static void *fishbone_gauge_dispose(FishboneGauge *self);
 static BaseGaugeOps fishbone_gauge_ops = {
+   .name = "FishboneGauge",
    .render = (RenderFunc)fishbone_gauge_render,
    .update_state = (StateUpdateFunc)fishbone_gauge_update_state,
    .dispose = (DisposeFunc)fishbone_gauge_dispose
@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "flight-log-data-source.h"
+
+static bool flight_log_data_source_frame(FlightLogDataSource *self, uint32_t dt);
+static FlightLogDataSource *flight_log_data_source_dispose(FlightLogDataSource *self);
+static DataSourceOps flight_log_data_source_ops = {
+    .frame = (DataSourceFrameFunc)flight_log_data_source_frame,
+    .dispose = (DataSourceDisposeFunc)flight_log_data_source_dispose
+};
+
+FlightLogDataSource *flight_log_data_source_new(const char *filename)
+{
+    FlightLogDataSource *self;
+
+    self = calloc(1, sizeof(FlightLogDataSource));
+    if(self){
+        if(!flight_log_data_source_init(self, filename)){
+            data_source_free(DATA_SOURCE(self));
+            return NULL;
+        }
+    }
+    return self;
+}
+
+FlightLogDataSource *flight_log_data_source_init(FlightLogDataSource *self, const char *filename)
+{
+    if(!data_source_init(DATA_SOURCE(self), &flight_log_data_source_ops))
+        return NULL;
+
+    self->log = flight_log_new(filename, false);
+    if(!self->log)
+        return NULL;
+
+    self->has_pending = flight_log_read(self->log, &self->pending);
+    if(!self->has_pending)
+        printf("%s: %s is empty\n", __FUNCTION__, filename);
+    self->playing = true;
+
+    return self;
+}
+
+static FlightLogDataSource *flight_log_data_source_dispose(FlightLogDataSource *self)
+{
+    if(self->log)
+        flight_log_free(self->log);
+    return self;
+}
+
+static bool flight_log_data_source_frame(FlightLogDataSource *self, uint32_t dt)
+{
+    FlightLogRecord latest[ENGINE_DATA+1];
+    bool fresh[ENGINE_DATA+1] = {false};
+    uint64_t position;
+    bool rv;
+
+    if(!DATA_SOURCE(self)->worker && dt != 0 && dt < (1000/25)) //One update per 1/25 second
+        return false;
+
+    if(!self->playing || self->ended)
+        return false;
+
+    /* dt is the time since the last frame that returned true, the
+     * position only moves along with it. Only the last value of each
+     * kind matters*/
+    position = self->position + dt * 1000000ULL;
+    while(self->has_pending && self->pending.t <= position){
+        latest[self->pending.type] = self->pending;
+        fresh[self->pending.type] = true;
+        self->has_pending = flight_log_read(self->log, &self->pending);
+    }
+    if(!self->has_pending)
+        self->ended = true;
+
+    /* Timestamps are reset so that setters stamp values with the
+     * replay time, like for a live source*/
+    rv = false;
+    if(fresh[LOCATION_DATA]){
+        latest[LOCATION_DATA].location.timestamp = 0;
+        data_source_set_location(DATA_SOURCE(self), &latest[LOCATION_DATA].location);
+        rv = true;
+    }
+    if(fresh[ATTITUDE_DATA]){
+        latest[ATTITUDE_DATA].attitude.timestamp = 0;
+        data_source_set_attitude(DATA_SOURCE(self), &latest[ATTITUDE_DATA].attitude);
+        rv = true;
+    }
+    if(fresh[DYNAMICS_DATA]){
+        latest[DYNAMICS_DATA].dynamics.timestamp = 0;
+        data_source_set_dynamics(DATA_SOURCE(self), &latest[DYNAMICS_DATA].dynamics);
+        rv = true;
+    }
+    if(fresh[ENGINE_DATA]){
+        latest[ENGINE_DATA].engine_data.timestamp = 0;
+        data_source_set_engine_data(DATA_SOURCE(self), &latest[ENGINE_DATA].engine_data);
+        rv = true;
+    }
+
+    if(rv){
+        self->position = position;
+        data_source_set_fix(DATA_SOURCE(self));
+    }
+    return rv;
+}
@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef FLIGHT_LOG_DATA_SOURCE_H
+#define FLIGHT_LOG_DATA_SOURCE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data-source.h"
+#include "flight-log.h"
+
+/*Replays a flight log recorded with data_source_record*/
+typedef struct{
+    DataSource super;
+
+    FlightLog *log;
+    FlightLogRecord pending; /*Next record, read ahead*/
+    bool has_pending;
+
+    uint64_t position; /*ns since the first record*/
+    bool playing;
+    bool ended; /*Reached the end of the log (or failed reading it)*/
+}FlightLogDataSource;
+
+FlightLogDataSource *flight_log_data_source_new(const char *filename);
+FlightLogDataSource *flight_log_data_source_init(FlightLogDataSource *self, const char *filename);
+#endif /* FLIGHT_LOG_DATA_SOURCE_H */
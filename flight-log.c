@@ -0,0 +1,293 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#include "flight-log.h"
+
+#define MAX_VARINT 10
+
+typedef struct{
+    size_t offset; /*in FlightLogRecord*/
+    size_t size; /*4 (float) or 8 (double)*/
+}FlightLogField;
+
+#define LOG_FIELD(member) {offsetof(FlightLogRecord, member), sizeof(((FlightLogRecord*)0)->member)}
+
+static const FlightLogField location_fields[] = {
+    LOG_FIELD(location.super.latitude),
+    LOG_FIELD(location.super.longitude),
+    LOG_FIELD(location.altitude),
+};
+
+static const FlightLogField attitude_fields[] = {
+    LOG_FIELD(attitude.roll),
+    LOG_FIELD(attitude.pitch),
+    LOG_FIELD(attitude.heading),
+};
+
+static const FlightLogField dynamics_fields[] = {
+    LOG_FIELD(dynamics.airspeed),
+    LOG_FIELD(dynamics.vertical_speed),
+    LOG_FIELD(dynamics.slip_rad),
+    LOG_FIELD(dynamics.groundspeed),
+    LOG_FIELD(dynamics.track),
+};
+
+static const FlightLogField engine_data_fields[] = {
+    LOG_FIELD(engine_data.rpm),
+    LOG_FIELD(engine_data.fuel_flow),
+    LOG_FIELD(engine_data.fuel_px),
+    LOG_FIELD(engine_data.oil_temp),
+    LOG_FIELD(engine_data.oil_press),
+    LOG_FIELD(engine_data.cht),
+    LOG_FIELD(engine_data.fuel_qty),
+    LOG_FIELD(engine_data.egt),
+    LOG_FIELD(engine_data.man_press),
+    LOG_FIELD(engine_data.volts),
+};
+
+#define TABLE(fields) {fields, sizeof(fields)/sizeof(fields[0])}
+static const struct{
+    const FlightLogField *fields;
+    size_t nfields;
+}flight_log_tables[ENGINE_DATA+1] = {
+    [LOCATION_DATA] = TABLE(location_fields),
+    [ATTITUDE_DATA] = TABLE(attitude_fields),
+    [DYNAMICS_DATA] = TABLE(dynamics_fields),
+    [ENGINE_DATA] = TABLE(engine_data_fields),
+};
+
+/*Timestamps live in the value itself too*/
+static inline uint64_t *record_timestamp(FlightLogRecord *record)
+{
+    switch(record->type){
+        case LOCATION_DATA: return &record->location.timestamp;
+        case ATTITUDE_DATA: return &record->attitude.timestamp;
+        case DYNAMICS_DATA: return &record->dynamics.timestamp;
+        case ENGINE_DATA: return &record->engine_data.timestamp;
+        default: return NULL;
+    }
+}
+
+static inline uint64_t field_bits(const FlightLogRecord *record, const FlightLogField *field)
+{
+    uint32_t u32;
+    uint64_t u64;
+
+    if(field->size == sizeof(uint32_t)){
+        memcpy(&u32, (uint8_t*)record + field->offset, sizeof(uint32_t));
+        return u32;
+    }
+    memcpy(&u64, (uint8_t*)record + field->offset, sizeof(uint64_t));
+    return u64;
+}
+
+static inline void field_set_bits(FlightLogRecord *record, const FlightLogField *field, uint64_t bits)
+{
+    uint32_t u32;
+
+    if(field->size == sizeof(uint32_t)){
+        u32 = bits;
+        memcpy((uint8_t*)record + field->offset, &u32, sizeof(uint32_t));
+        return;
+    }
+    memcpy((uint8_t*)record + field->offset, &bits, sizeof(uint64_t));
+}
+
+static inline size_t varint_encode(uint64_t v, uint8_t *buf)
+{
+    size_t i = 0;
+
+    while(v >= 0x80){
+        buf[i++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    buf[i++] = v;
+    return i;
+}
+
+static bool varint_read(FILE *fp, uint64_t *v)
+{
+    int c;
+
+    *v = 0;
+    for(int shift = 0; shift < 7 * MAX_VARINT; shift += 7){
+        c = getc(fp);
+        if(c == EOF)
+            return false;
+        *v |= (uint64_t)(c & 0x7f) << shift;
+        if(!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool flight_log_write_header(FlightLog *self)
+{
+    struct timeval tv;
+    uint8_t buf[sizeof(FLIGHT_LOG_MAGIC) - 1 + 1 + sizeof(uint64_t)];
+    uint8_t *p = buf;
+
+    gettimeofday(&tv, NULL);
+    self->start = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    memcpy(p, FLIGHT_LOG_MAGIC, sizeof(FLIGHT_LOG_MAGIC) - 1);
+    p += sizeof(FLIGHT_LOG_MAGIC) - 1;
+    *p++ = FLIGHT_LOG_VERSION;
+    for(int i = 0; i < 8; i++)
+        *p++ = self->start >> (8 * i);
+    return fwrite(buf, sizeof(buf), 1, self->fp) == 1;
+}
+
+static bool flight_log_read_header(FlightLog *self)
+{
+    uint8_t buf[sizeof(FLIGHT_LOG_MAGIC) - 1 + 1 + sizeof(uint64_t)];
+    uint8_t *p = buf;
+
+    if(fread(buf, sizeof(buf), 1, self->fp) != 1)
+        return false;
+    if(memcmp(p, FLIGHT_LOG_MAGIC, sizeof(FLIGHT_LOG_MAGIC) - 1))
+        return false;
+    p += sizeof(FLIGHT_LOG_MAGIC) - 1;
+    if(*p++ != FLIGHT_LOG_VERSION)
+        return false;
+    self->start = 0;
+    for(int i = 0; i < 8; i++)
+        self->start |= (uint64_t)*p++ << (8 * i);
+    return true;
+}
+
+FlightLog *flight_log_new(const char *filename, bool writing)
+{
+    FlightLog *self;
+    bool rv;
+
+    self = calloc(1, sizeof(FlightLog));
+    if(!self)
+        return NULL;
+
+    self->fp = fopen(filename, writing ? "wb" : "rb");
+    if(!self->fp){
+        printf("%s: couldn't open %s: %s\n", __FUNCTION__, filename, strerror(errno));
+        free(self);
+        return NULL;
+    }
+    self->writing = writing;
+
+    rv = writing ? flight_log_write_header(self) : flight_log_read_header(self);
+    if(!rv){
+        printf("%s: %s: %s\n", __FUNCTION__, filename,
+            writing ? "couldn't write header" : "not a flight log (or unsupported version)"
+        );
+        flight_log_free(self);
+        return NULL;
+    }
+    return self;
+}
+
+void flight_log_free(FlightLog *self)
+{
+    if(self->fp)
+        fclose(self->fp);
+    free(self);
+}
+
+/**
+ * @brief Appends a record. Records must be written in chronological
+ * order.
+ */
+bool flight_log_write(FlightLog *self, const FlightLogRecord *record)
+{
+    uint8_t buf[1 + MAX_VARINT * (2 + 16)];
+    FlightLogRecord *last;
+    uint64_t t, bits[16];
+    uint64_t mask;
+    size_t len, nfields;
+    const FlightLogField *fields;
+
+    if(record->type > ENGINE_DATA)
+        return false;
+    fields = flight_log_tables[record->type].fields;
+    nfields = flight_log_tables[record->type].nfields;
+    last = &self->last[record->type];
+
+    t = record->t / 1000;
+    if(self->has_t && t < self->t)
+        t = self->t; /*Keep deltas unsigned*/
+
+    mask = 0;
+    for(int i = 0; i < nfields; i++){
+        bits[i] = field_bits(record, &fields[i]) ^ field_bits(last, &fields[i]);
+        if(bits[i])
+            mask |= 1 << i;
+    }
+
+    len = 0;
+    buf[len++] = record->type;
+    len += varint_encode(self->has_t ? t - self->t : 0, buf + len);
+    len += varint_encode(mask, buf + len);
+    for(int i = 0; i < nfields; i++){
+        if(mask & (1 << i))
+            len += varint_encode(bits[i], buf + len);
+    }
+    if(fwrite(buf, len, 1, self->fp) != 1)
+        return false;
+
+    self->t = t;
+    self->has_t = true;
+    *last = *record;
+    return true;
+}
+
+/**
+ * @brief Reads the next record. Times (FlightLogRecord.t and the value
+ * timestamp) are relative to the first record of the log, in ns.
+ *
+ * @return true if @p record has been filled, false at the end of the log
+ * or if it is corrupted.
+ */
+bool flight_log_read(FlightLog *self, FlightLogRecord *record)
+{
+    FlightLogRecord *last;
+    const FlightLogField *fields;
+    uint64_t dt, mask, bits;
+    size_t nfields;
+    int type;
+
+    type = getc(self->fp);
+    if(type == EOF)
+        return false;
+    if(type > ENGINE_DATA){
+        printf("%s: bad record type %d at offset %ld, giving up\n", __FUNCTION__, type, ftell(self->fp) - 1);
+        return false;
+    }
+    if(!varint_read(self->fp, &dt) || !varint_read(self->fp, &mask))
+        return false;
+
+    fields = flight_log_tables[type].fields;
+    nfields = flight_log_tables[type].nfields;
+    last = &self->last[type];
+    for(int i = 0; i < nfields; i++){
+        if(!(mask & (1 << i)))
+            continue;
+        if(!varint_read(self->fp, &bits))
+            return false;
+        field_set_bits(last, &fields[i], field_bits(last, &fields[i]) ^ bits);
+    }
+
+    self->t += dt;
+    last->type = type;
+    last->t = self->t * 1000;
+    *record_timestamp(last) = last->t;
+    *record = *last;
+    return true;
+}
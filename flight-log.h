@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "data-source.h"
+
+#define FLIGHT_LOG_MAGIC "SFDR"
+#define FLIGHT_LOG_VERSION 1
+
+/* A value as delivered by a DataSource setter. Route data isn't part of
+ * the log: it is set by the user, not acquired*/
+typedef struct{
+    DataType type; /*LOCATION_DATA to ENGINE_DATA*/
+    uint64_t t; /*monotonic_ns(), same as the value timestamp*/
+    union{
+        LocationData location;
+        AttitudeData attitude;
+        DynamicsData dynamics;
+        EngineData engine_data;
+    };
+}FlightLogRecord;
+
+/* Binary flight data log. After a header (magic, version, wall-clock
+ * time of the start in µs since the epoch as uint64 LE), each record is:
+ *  - type: 1 byte
+ *  - time since the previous record, µs: varint
+ *  - mask of the fields that changed since the previous record of that
+ *    type: varint
+ *  - for each of them, the bits of the new value XORed with the previous
+ *    one: varint
+ * Varints are LEB128. Slowly changing values only differ in their low
+ * mantissa bits, which keeps the XOR small, and unchanged ones take no
+ * room at all.
+ */
+typedef struct{
+    FILE *fp;
+    bool writing;
+
+    uint64_t start; /*µs since the epoch*/
+    uint64_t t; /*µs, last record*/
+    bool has_t;
+    FlightLogRecord last[ENGINE_DATA+1]; /*Per type, for delta encoding*/
+}FlightLog;
+
+FlightLog *flight_log_new(const char *filename, bool writing);
+void flight_log_free(FlightLog *self);
+
+bool flight_log_write(FlightLog *self, const FlightLogRecord *record);
+bool flight_log_read(FlightLog *self, FlightLogRecord *record);
+#endif /* FLIGHT_LOG_H */
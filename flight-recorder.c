@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "flight-recorder.h"
+
+#define SLOT_MASK (FLIGHT_RECORDER_SLOTS - 1)
+
+static void *flight_recorder_writer(FlightRecorder *self);
+
+FlightRecorder *flight_recorder_new(const char *filename)
+{
+    FlightRecorder *self;
+    int err;
+
+    self = calloc(1, sizeof(FlightRecorder));
+    if(!self)
+        return NULL;
+
+    self->log = flight_log_new(filename, true);
+    if(!self->log){
+        free(self);
+        return NULL;
+    }
+    atomic_init(&self->head, 0);
+    atomic_init(&self->tail, 0);
+    atomic_init(&self->dropped, 0);
+    atomic_init(&self->running, true);
+
+    err = pthread_create(&self->tid, NULL, (void*)flight_recorder_writer, self);
+    if(err){
+        printf("%s: couldn't create writer thread: %s\n", __FUNCTION__, strerror(err));
+        flight_log_free(self->log);
+        free(self);
+        return NULL;
+    }
+    return self;
+}
+
+/**
+ * @brief Stops recording, writing whatever is still pending.
+ */
+void flight_recorder_free(FlightRecorder *self)
+{
+    size_t dropped;
+
+    atomic_store(&self->running, false);
+    pthread_join(self->tid, NULL);
+
+    dropped = atomic_load(&self->dropped);
+    printf("Flight recorder: %zu records written, %zu dropped\n", self->written, dropped);
+
+    flight_log_free(self->log);
+    free(self);
+}
+
+/**
+ * @brief Queues a value for writing. Never blocks. To be always called
+ * from the same thread.
+ *
+ * @param type LOCATION_DATA to ENGINE_DATA
+ * @param value LocationData, AttitudeData, etc. depending on @p type, its
+ * timestamp must be set
+ * @return true if queued, false if the ring was full and the value has
+ * been dropped
+ */
+bool flight_recorder_push(FlightRecorder *self, DataType type, const void *value)
+{
+    FlightLogRecord *record;
+    size_t head, tail;
+
+    head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+    if(head - tail == FLIGHT_RECORDER_SLOTS){
+        atomic_fetch_add_explicit(&self->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    record = &self->slots[head & SLOT_MASK];
+    record->type = type;
+    switch(type){
+        case LOCATION_DATA:
+            record->location = *(LocationData*)value;
+            record->t = record->location.timestamp;
+            break;
+        case ATTITUDE_DATA:
+            record->attitude = *(AttitudeData*)value;
+            record->t = record->attitude.timestamp;
+            break;
+        case DYNAMICS_DATA:
+            record->dynamics = *(DynamicsData*)value;
+            record->t = record->dynamics.timestamp;
+            break;
+        case ENGINE_DATA:
+            record->engine_data = *(EngineData*)value;
+            record->t = record->engine_data.timestamp;
+            break;
+        default:
+            return false;
+    }
+    atomic_store_explicit(&self->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void flight_recorder_drain(FlightRecorder *self)
+{
+    size_t head, tail;
+
+    tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&self->head, memory_order_acquire);
+    if(tail == head)
+        return;
+
+    for(; tail != head; tail++){
+        if(flight_log_write(self->log, &self->slots[tail & SLOT_MASK]))
+            self->written++;
+        /*Hand the slot back as soon as it's been encoded*/
+        atomic_store_explicit(&self->tail, tail + 1, memory_order_release);
+    }
+    fflush(self->log->fp);
+}
+
+static void *flight_recorder_writer(FlightRecorder *self)
+{
+    while(atomic_load(&self->running)){
+        flight_recorder_drain(self);
+        usleep(FLIGHT_RECORDER_PERIOD * 1000);
+    }
+    flight_recorder_drain(self);
+    return NULL;
+}
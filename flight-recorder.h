@@ -0,0 +1,44 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "data-source.h"
+#include "flight-log.h"
+
+#define FLIGHT_RECORDER_SLOTS 1024 /*Power of 2*/
+#define FLIGHT_RECORDER_PERIOD 50 /*ms between two writes to the disk*/
+
+/* Writes the values a DataSource delivers to a FlightLog, without ever
+ * stalling the thread that delivers them: records go through a single
+ * producer/single consumer ring to a writer thread that does the
+ * encoding and the I/O. When the ring is full (disk too slow), records
+ * are dropped and counted.
+ */
+typedef struct _FlightRecorder{
+    FlightLog *log;
+
+    FlightLogRecord slots[FLIGHT_RECORDER_SLOTS];
+    atomic_size_t head; /*Next slot to fill, producer*/
+    atomic_size_t tail; /*Next slot to write, writer thread*/
+    atomic_size_t dropped;
+    size_t written; /*writer thread only*/
+
+    pthread_t tid;
+    atomic_bool running;
+}FlightRecorder;
+
+FlightRecorder *flight_recorder_new(const char *filename);
+void flight_recorder_free(FlightRecorder *self);
+
+bool flight_recorder_push(FlightRecorder *self, DataType type, const void *value);
+#endif /* FLIGHT_RECORDER_H */
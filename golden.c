@@ -0,0 +1,486 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+/*
+ * Golden-image regression check.
+ *
+ * Renders each gauge type offscreen at a fixed set of values, without
+ * animations, and compares the pixels against reference PNGs stored in
+ * GOLDEN_DIR (resources/golden). Meant to be run before and after touching
+ * the blitting code:
+ *   ./golden -u      records the references (on a known good tree)
+ *   ./golden         compares against them, non-zero exit on mismatch
+ *
+ * A pixel differs when any of its channels is off by more than the
+ * tolerance (-t), a sample fails when more than -p percent of its pixels
+ * differ. Failing samples are written next to the references as
+ * <name>-<n>.actual.png for inspection. Samples that have no reference
+ * yet are skipped, not failed, unless none has one.
+ *
+ * With SDL_gpu a GL context is still needed, see bench.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#if USE_SDL_GPU
+#include <SDL_gpu.h>
+#endif
+
+#include "alt-ladder-page-descriptor.h"
+#include "attitude-indicator.h"
+#include "base-gauge.h"
+#include "compass-gauge.h"
+#include "data-source.h"
+#include "digit-barrel.h"
+#include "elevator-gauge.h"
+#include "fishbone-gauge.h"
+#include "ladder-gauge.h"
+#include "misc.h"
+#include "mock-data-source.h"
+#include "odo-gauge.h"
+#include "res-dirs.h"
+#include "resource-manager.h"
+#include "sdl-colors.h"
+#include "text-gauge.h"
+
+#define SCREEN_WIDTH 640
+#define SCREEN_HEIGHT 480
+
+#define DEFAULT_TOLERANCE 8 /*per channel, out of 255*/
+#define DEFAULT_MAX_DIFF 0.1 /*percent of the pixels*/
+
+#define GOLDEN_MAX_PARAMS 3
+
+typedef BaseGauge *(*GoldenCreateFunc)(void);
+typedef void (*GoldenSetFunc)(BaseGauge *gauge, float *params);
+
+typedef struct{
+    const char *name;
+    GoldenCreateFunc create;
+    GoldenSetFunc set;
+    int nsamples;
+    float (*samples)[GOLDEN_MAX_PARAMS];
+}GoldenCase;
+
+typedef struct{
+    const char *dir;
+    const char *filter;
+    bool update;
+    int tolerance;
+    double max_diff;
+    int nskipped; /*Samples without a reference*/
+
+    RenderTarget rtarget;
+#if USE_SDL_GPU
+    GPU_Image *offscreen;
+#else
+    SDL_Surface *offscreen;
+#endif
+}GoldenRun;
+
+/*Gauges under test, built the same way the HUD and the side panel do*/
+static BaseGauge *golden_ladder_new(void)
+{
+    return BASE_GAUGE(ladder_gauge_new((LadderPageDescriptor *)alt_ladder_page_descriptor_new(), -1));
+}
+
+static void golden_ladder_set(BaseGauge *gauge, float *params)
+{
+    ladder_gauge_set_value((LadderGauge*)gauge, params[0], false);
+}
+
+static BaseGauge *golden_odo_new(void)
+{
+    PCF_Font *fnt = resource_manager_get_font(TERMINUS_18);
+    DigitBarrel *db = digit_barrel_new(fnt, 0, 9.999, 1);
+    DigitBarrel *db2 = digit_barrel_new(fnt, 0, 99, 10);
+
+    return BASE_GAUGE(odo_gauge_new_multiple(-1, 4,
+        -1, db2,
+        -2, db,
+        -2, db,
+        -2, db
+    ));
+}
+
+static void golden_odo_set(BaseGauge *gauge, float *params)
+{
+    odo_gauge_set_value((OdoGauge*)gauge, params[0], false);
+}
+
+static BaseGauge *golden_attitude_new(void)
+{
+    AttitudeIndicator *rv;
+
+    rv = attitude_indicator_new(SCREEN_WIDTH, SCREEN_HEIGHT);
+    if(rv)
+        rv->mode = AI_MODE_2D;
+    return BASE_GAUGE(rv);
+}
+
+static void golden_attitude_set(BaseGauge *gauge, float *params)
+{
+    attitude_indicator_set_pitch((AttitudeIndicator*)gauge, params[0], false);
+    attitude_indicator_set_roll((AttitudeIndicator*)gauge, params[1], false);
+    attitude_indicator_set_heading((AttitudeIndicator*)gauge, params[2]);
+}
+
+static BaseGauge *golden_compass_new(void)
+{
+    return BASE_GAUGE(compass_gauge_new());
+}
+
+static void golden_compass_set(BaseGauge *gauge, float *params)
+{
+    compass_gauge_set_value((CompassGauge*)gauge, params[0], false);
+}
+
+static BaseGauge *golden_fishbone_new(void)
+{
+    return BASE_GAUGE(fishbone_gauge_new(true,
+        resource_manager_get_font(TERMINUS_12), SDL_WHITE,
+        0, 100, 20,
+        92 - 10, 15,
+        4,(ColorZone[]){{
+            .from = 0,
+            .to = 20,
+            .color = SDL_RED,
+            .flags = FromIncluded | ToIncluded
+        },{
+        .from = 20,
+        .to = 60,
+        .color = SDL_GREEN,
+        .flags = FromExcluded | ToIncluded
+        },{
+        .from = 60,
+        .to = 80,
+        .color = SDL_YELLOW,
+        .flags = FromExcluded | ToIncluded
+        },{
+        .from = 80,
+        .to = 100,
+        .color = SDL_RED,
+        .flags = FromExcluded | ToIncluded
+        }}
+    ));
+}
+
+static void golden_fishbone_set(BaseGauge *gauge, float *params)
+{
+    fishbone_gauge_set_value((FishboneGauge*)gauge, params[0], false);
+}
+
+static BaseGauge *golden_elevator_new(void)
+{
+    return BASE_GAUGE(elevator_gauge_new(true,
+        Left,
+        resource_manager_get_font(TERMINUS_12), SDL_WHITE,
+        0, 3000, 300,
+        15, 110,
+        3,(ColorZone[]){{
+            .from = 0,
+            .to = 2600,
+            .color = SDL_GREEN,
+            .flags = FromIncluded | ToIncluded
+        },{
+        .from = 2600,
+        .to = 2800,
+        .color = SDL_YELLOW,
+        .flags = FromExcluded | ToIncluded
+        },{
+        .from = 2800,
+        .to = 3000,
+        .color = SDL_RED,
+        .flags = FromExcluded | ToIncluded
+        }}
+    ));
+}
+
+static void golden_elevator_set(BaseGauge *gauge, float *params)
+{
+    elevator_gauge_set_value((ElevatorGauge*)gauge, params[0], false);
+}
+
+static BaseGauge *golden_text_new(void)
+{
+    TextGauge *rv;
+
+    rv = text_gauge_new(NULL, true, 92 - 10, 16);
+    if(!rv)
+        return NULL;
+    text_gauge_set_static_font(rv,
+        resource_manager_get_static_font(TERMINUS_16,
+            &SDL_WHITE,
+            3, PCF_ALPHA, PCF_DIGITS, ".-"
+        )
+    );
+    text_gauge_set_color(rv, SDL_BLACK, BACKGROUND_COLOR);
+    return BASE_GAUGE(rv);
+}
+
+static void golden_text_set(BaseGauge *gauge, float *params)
+{
+    text_gauge_set_value_formatn((TextGauge*)gauge, 16, "%0.1f GPH", params[0]);
+}
+
+#define SAMPLES(...) \
+    sizeof((float[][GOLDEN_MAX_PARAMS]){__VA_ARGS__})/sizeof(float[GOLDEN_MAX_PARAMS]), \
+    (float[][GOLDEN_MAX_PARAMS]){__VA_ARGS__}
+
+static GoldenCase cases[] = {
+    {"LadderGauge", golden_ladder_new, golden_ladder_set,
+        SAMPLES({0}, {950}, {1000.5}, {4875}, {12500})},
+    {"OdoGauge", golden_odo_new, golden_odo_set,
+        SAMPLES({0}, {9}, {99.5}, {1234.5}, {9999})},
+    {"AttitudeIndicator", golden_attitude_new, golden_attitude_set,
+        SAMPLES({0,0,0}, {10,0,90}, {-15,0,180}, {0,30,270}, {5,-45,45}, {-20,60,359})},
+    {"CompassGauge", golden_compass_new, golden_compass_set,
+        SAMPLES({0}, {45}, {90}, {182.5}, {270}, {359})},
+    {"FishboneGauge", golden_fishbone_new, golden_fishbone_set,
+        SAMPLES({0}, {20}, {50.5}, {80}, {100})},
+    {"ElevatorGauge", golden_elevator_new, golden_elevator_set,
+        SAMPLES({0}, {1200}, {2600}, {2750}, {3000})},
+    {"TextGauge", golden_text_new, golden_text_set,
+        SAMPLES({0}, {8.5}, {-1}, {123.4})},
+    {NULL, NULL, NULL, 0, NULL}
+};
+
+/*Renders @p gauge alone at the top left corner and reads it back*/
+static SDL_Surface *golden_run_snapshot(GoldenRun *self, BaseGauge *gauge)
+{
+    SDL_Surface *frame, *rv;
+    SDL_Rect area;
+
+    area = (SDL_Rect){0, 0, base_gauge_w(gauge), base_gauge_h(gauge)};
+    if(area.w > SCREEN_WIDTH || area.h > SCREEN_HEIGHT){
+        printf("Gauge bigger than the offscreen target (%dx%d), skipping\n", area.w, area.h);
+        return NULL;
+    }
+
+#if USE_SDL_GPU
+    GPU_ClearRGB(self->rtarget.target, 0x11, 0x56, 0xFF);
+#else
+    SDL_FillRect(self->offscreen, NULL, SDL_MapRGB(self->offscreen->format, 0x11, 0x56, 0xFF));
+#endif
+    /*No animations: a zero dt is enough for the state to settle*/
+    base_gauge_render(gauge, 0, &(RenderContext){self->rtarget, &area, NULL});
+
+#if USE_SDL_GPU
+    GPU_FlushBlitBuffer();
+    frame = GPU_CopySurfaceFromTarget(self->rtarget.target);
+    if(!frame){
+        printf("Couldn't read back offscreen target\n");
+        return NULL;
+    }
+#else
+    frame = self->offscreen;
+#endif
+    rv = SDL_CreateRGBSurfaceWithFormat(0, area.w, area.h, 32, SDL_PIXELFORMAT_RGBA32);
+    if(rv){
+        SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(frame, &area, rv, NULL);
+    }
+#if USE_SDL_GPU
+    SDL_FreeSurface(frame);
+#endif
+    return rv;
+}
+
+/*Returns the number of pixels differing by more than @p tolerance*/
+static size_t golden_compare(SDL_Surface *actual, SDL_Surface *expected, int tolerance)
+{
+    size_t ndiff = 0;
+
+    for(int y = 0; y < actual->h; y++){
+        Uint8 *a = (Uint8*)actual->pixels + y * actual->pitch;
+        Uint8 *e = (Uint8*)expected->pixels + y * expected->pitch;
+
+        for(int x = 0; x < actual->w * 4; x += 4){
+            for(int c = 0; c < 4; c++){
+                if(abs(a[x+c] - e[x+c]) > tolerance){
+                    ndiff++;
+                    break;
+                }
+            }
+        }
+    }
+    return ndiff;
+}
+
+/*Returns false on mismatch, true otherwise (including when skipped)*/
+static bool golden_run_sample(GoldenRun *self, GoldenCase *gcase, int idx, SDL_Surface *actual)
+{
+    char path[512];
+    SDL_Surface *loaded, *expected;
+    size_t ndiff;
+    double pct;
+    bool rv;
+
+    snprintf(path, sizeof(path), "%s/%s-%d.png", self->dir, gcase->name, idx);
+    if(self->update){
+        if(!create_path(path) || IMG_SavePNG(actual, path) != 0){
+            printf("%s: couldn't write: %s\n", path, IMG_GetError());
+            return false;
+        }
+        printf("%s: updated\n", path);
+        return true;
+    }
+
+    loaded = IMG_Load(path);
+    if(!loaded){
+        printf("%s: no reference, skipped (run with -u on a known good tree)\n", path);
+        self->nskipped++;
+        return true;
+    }
+    expected = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if(!expected){
+        printf("%s: couldn't convert: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    if(expected->w != actual->w || expected->h != actual->h){
+        printf("%s: FAIL size %dx%d, expected %dx%d\n",
+            path, actual->w, actual->h, expected->w, expected->h
+        );
+        rv = false;
+    }else{
+        ndiff = golden_compare(actual, expected, self->tolerance);
+        pct = 100.0 * ndiff / (actual->w * actual->h);
+        rv = pct <= self->max_diff;
+        if(!rv || ndiff)
+            printf("%s: %s %zu pixels (%.3f%%) differ\n", path, rv ? "ok," : "FAIL", ndiff, pct);
+    }
+    SDL_FreeSurface(expected);
+
+    if(!rv){
+        snprintf(path, sizeof(path), "%s/%s-%d.actual.png", self->dir, gcase->name, idx);
+        IMG_SavePNG(actual, path);
+    }
+    return rv;
+}
+
+/*Returns the number of failed samples*/
+static int golden_run_case(GoldenRun *self, GoldenCase *gcase)
+{
+    BaseGauge *gauge;
+    int nfailed = 0;
+
+    gauge = gcase->create();
+    if(!gauge){
+        printf("%s: couldn't create gauge\n", gcase->name);
+        return gcase->nsamples;
+    }
+
+    for(int i = 0; i < gcase->nsamples; i++){
+        SDL_Surface *actual;
+
+        gcase->set(gauge, gcase->samples[i]);
+        actual = golden_run_snapshot(self, gauge);
+        if(!actual || !golden_run_sample(self, gcase, i, actual))
+            nfailed++;
+        if(actual)
+            SDL_FreeSurface(actual);
+    }
+    base_gauge_free(gauge);
+    return nfailed;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-u] [-d dir] [-t tolerance] [-p max %% of differing pixels] [-f gauge]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    GoldenRun run = {
+        .dir = GOLDEN_DIR,
+        .tolerance = DEFAULT_TOLERANCE,
+        .max_diff = DEFAULT_MAX_DIFF
+    };
+    int nfailed, ntotal;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-u"))
+            run.update = true;
+        else if(!strcmp(argv[i], "-d") && i+1 < argc)
+            run.dir = argv[++i];
+        else if(!strcmp(argv[i], "-t") && i+1 < argc)
+            run.tolerance = strtol(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "-p") && i+1 < argc)
+            run.max_diff = strtod(argv[++i], NULL);
+        else if(!strcmp(argv[i], "-f") && i+1 < argc)
+            run.filter = argv[++i];
+        else{
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+#if USE_SDL_GPU
+    GPU_Target *screen;
+
+	GPU_SetRequiredFeatures(GPU_FEATURE_BASIC_SHADERS);
+#if USE_GLES
+    screen = GPU_InitRenderer(GPU_RENDERER_GLES_2, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+#else
+    screen = GPU_InitRenderer(GPU_RENDERER_OPENGL_2, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+#endif
+    if(!screen){
+        GPU_LogError("Couldn't create a GL context, try SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1\n");
+        exit(EXIT_FAILURE);
+    }
+    run.offscreen = GPU_CreateImage(SCREEN_WIDTH, SCREEN_HEIGHT, GPU_FORMAT_RGBA);
+    if(!run.offscreen || !GPU_LoadTarget(run.offscreen)){
+        GPU_LogError("Couldn't create offscreen target\n");
+        exit(EXIT_FAILURE);
+    }
+    run.rtarget.target = run.offscreen->target;
+#else
+    run.offscreen = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(!run.offscreen){
+        printf("Couldn't create offscreen surface: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    run.rtarget.surface = run.offscreen;
+#endif
+    /*Some gauges query the global DataSource when built*/
+    data_source_set((DataSource*)mock_data_source_new());
+
+    nfailed = ntotal = 0;
+    for(GoldenCase *c = cases; c->name; c++){
+        if(run.filter && !strstr(c->name, run.filter))
+            continue;
+        nfailed += golden_run_case(&run, c);
+        ntotal += c->nsamples;
+    }
+    printf("%d/%d samples %s",
+        ntotal - nfailed - run.nskipped, ntotal, run.update ? "recorded" : "passed"
+    );
+    if(run.nskipped)
+        printf(", %d skipped", run.nskipped);
+    printf("\n");
+    /*Nothing compared at all can't pass for a check*/
+    if(ntotal && run.nskipped == ntotal){
+        printf("No reference in %s, record them with -u on a known good tree\n", run.dir);
+        nfailed = ntotal;
+    }
+
+    data_source_free(data_source_get_instance());
+    resource_manager_shutdown();
+#if USE_SDL_GPU
+    GPU_FreeImage(run.offscreen);
+	GPU_Quit();
+#else
+    SDL_FreeSurface(run.offscreen);
+#endif
+    return nfailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
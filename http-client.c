@@ -0,0 +1,248 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http-client.h"
+
+#define HTTP_CLIENT_WAIT_SLICE 100 /*ms, blocking mode*/
+
+static size_t http_client_write(void *contents, size_t size, size_t nmemb, HttpClient *self);
+static size_t http_client_header(char *line, size_t size, size_t nmemb, HttpClient *self);
+
+HttpClient *http_client_new(const char *url)
+{
+    HttpClient *self;
+
+    self = calloc(1, sizeof(HttpClient));
+    if(self){
+        if(!http_client_init(self, url)){
+            http_client_free(self);
+            return NULL;
+        }
+    }
+    return self;
+}
+
+/**
+ * @brief Sets up a client for @p url. Blocking by default, with
+ * HTTP_CLIENT_CONNECT_TIMEOUT and HTTP_CLIENT_TIMEOUT.
+ */
+HttpClient *http_client_init(HttpClient *self, const char *url)
+{
+    self->blocking = true;
+    self->buf = http_buffer_new(0);
+    self->curl = curl_easy_init();
+    /*Connections are cached by the multi handle*/
+    self->multi = curl_multi_init();
+    if(!self->buf || !self->curl || !self->multi)
+        return NULL;
+
+    curl_easy_setopt(self->curl, CURLOPT_URL, url);
+    curl_easy_setopt(self->curl,
+        CURLOPT_USERAGENT, "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_11_6) "
+        "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/69.0.3497.100 Safari/537.36"
+    );
+    curl_easy_setopt(self->curl, CURLOPT_WRITEFUNCTION, http_client_write);
+    curl_easy_setopt(self->curl, CURLOPT_WRITEDATA, (void *)self);
+    curl_easy_setopt(self->curl, CURLOPT_HEADERFUNCTION, http_client_header);
+    curl_easy_setopt(self->curl, CURLOPT_HEADERDATA, (void *)self);
+    curl_easy_setopt(self->curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(self->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    /*Timeouts must not rely on SIGALRM, we are running on worker threads*/
+    curl_easy_setopt(self->curl, CURLOPT_NOSIGNAL, 1L);
+    http_client_set_timeouts(self, HTTP_CLIENT_CONNECT_TIMEOUT, HTTP_CLIENT_TIMEOUT);
+
+    return self;
+}
+
+HttpClient *http_client_dispose(HttpClient *self)
+{
+    if(self->in_flight)
+        curl_multi_remove_handle(self->multi, self->curl);
+    if(self->multi)
+        curl_multi_cleanup(self->multi);
+    if(self->curl)
+        curl_easy_cleanup(self->curl);
+    curl_slist_free_all(self->headers);
+    if(self->buf){
+        free(self->buf->buffer);
+        free(self->buf);
+    }
+    return self;
+}
+
+void http_client_free(HttpClient *self)
+{
+    free(http_client_dispose(self));
+}
+
+/**
+ * @brief Bounds the time spent on a request.
+ *
+ * @param connect_timeout Max time to establish the connection, ms
+ * @param timeout Max time for the whole request, ms
+ */
+void http_client_set_timeouts(HttpClient *self, long connect_timeout, long timeout)
+{
+    curl_easy_setopt(self->curl, CURLOPT_CONNECTTIMEOUT_MS, connect_timeout);
+    curl_easy_setopt(self->curl, CURLOPT_TIMEOUT_MS, timeout);
+}
+
+/**
+ * @brief In non-blocking mode, http_client_get starts the request and
+ * returns HTTP_PENDING right away. Subsequent calls advance the transfer
+ * without waiting, until it completes.
+ */
+void http_client_set_blocking(HttpClient *self, bool blocking)
+{
+    self->blocking = blocking;
+}
+
+static void http_client_start(HttpClient *self)
+{
+    char line[160];
+
+    curl_slist_free_all(self->headers);
+    self->headers = NULL;
+    if(self->etag[0]){
+        snprintf(line, sizeof(line), "If-None-Match: %s", self->etag);
+        self->headers = curl_slist_append(self->headers, line);
+    }
+    if(self->last_modified[0]){
+        snprintf(line, sizeof(line), "If-Modified-Since: %s", self->last_modified);
+        self->headers = curl_slist_append(self->headers, line);
+    }
+    curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, self->headers);
+
+    self->status = 0;
+    self->has_body = false;
+    curl_multi_add_handle(self->multi, self->curl);
+    self->in_flight = true;
+}
+
+static HttpResult http_client_finish(HttpClient *self)
+{
+    CURLMsg *msg;
+    CURLcode res = CURLE_OK;
+    int remaining;
+
+    while((msg = curl_multi_info_read(self->multi, &remaining))){
+        if(msg->msg == CURLMSG_DONE && msg->easy_handle == self->curl)
+            res = msg->data.result;
+    }
+    curl_multi_remove_handle(self->multi, self->curl);
+    self->in_flight = false;
+
+    if(res != CURLE_OK)
+        return HTTP_ERROR;
+    curl_easy_getinfo(self->curl, CURLINFO_RESPONSE_CODE, &self->status);
+    if(self->status == 304)
+        return HTTP_NOT_MODIFIED;
+    /*buf would still hold the previous body, that must not pass for new*/
+    if(self->status < 200 || self->status > 299 || !self->has_body)
+        return HTTP_ERROR;
+    return HTTP_OK;
+}
+
+/**
+ * @brief Fetches the resource, reusing the connection when possible.
+ *
+ * @return HTTP_OK with the body in self->buf, HTTP_NOT_MODIFIED (self->buf
+ * still holds the previous body), HTTP_PENDING in non-blocking mode when
+ * there is no new data yet, or HTTP_ERROR, including for non-2xx statuses
+ * and bodiless responses.
+ */
+HttpResult http_client_get(HttpClient *self)
+{
+    CURLMcode mc;
+    int running;
+
+    if(!self->in_flight)
+        http_client_start(self);
+
+    while(true){
+        mc = curl_multi_perform(self->multi, &running);
+        if(mc != CURLM_OK){
+            printf("%s: %s\n", __FUNCTION__, curl_multi_strerror(mc));
+            curl_multi_remove_handle(self->multi, self->curl);
+            self->in_flight = false;
+            return HTTP_ERROR;
+        }
+        if(!running)
+            break;
+        if(!self->blocking)
+            return HTTP_PENDING;
+        curl_multi_wait(self->multi, NULL, 0, HTTP_CLIENT_WAIT_SLICE, NULL);
+    }
+
+    return http_client_finish(self);
+}
+
+static size_t http_client_write(void *contents, size_t size, size_t nmemb, HttpClient *self)
+{
+    size_t len;
+
+    len = size * nmemb;
+    /* Only drop the previous body once there is a new one. Error pages
+     * are discarded*/
+    if(!self->status)
+        curl_easy_getinfo(self->curl, CURLINFO_RESPONSE_CODE, &self->status);
+    if(self->status < 200 || self->status > 299)
+        return len;
+    if(!self->has_body){
+        self->buf->len = 0;
+        self->has_body = true;
+    }
+    return http_buffer_add_content(self->buf, contents, len) ? len : 0;
+}
+
+/*Copies the value of header @p name from @p line into @p dst, if it is the one*/
+static void http_client_match_header(const char *line, size_t len, const char *name, char *dst, size_t dst_size)
+{
+    size_t nlen;
+
+    nlen = strlen(name);
+    if(len <= nlen || strncasecmp(line, name, nlen) || line[nlen] != ':')
+        return;
+
+    line += nlen + 1;
+    len -= nlen + 1;
+    while(len && (*line == ' ' || *line == '\t')){
+        line++;
+        len--;
+    }
+    while(len && (line[len-1] == '\r' || line[len-1] == '\n'))
+        len--;
+    if(len >= dst_size) /*Wouldn't match anyway, don't send it back*/
+        len = 0;
+    memcpy(dst, line, len);
+    dst[len] = '\0';
+}
+
+static size_t http_client_header(char *line, size_t size, size_t nmemb, HttpClient *self)
+{
+    size_t len;
+
+    len = size * nmemb;
+    /* Status line: a new response begins. Validators of unchanged content
+     * are kept, the others will be superseded by the new headers*/
+    if(len > 12 && !strncmp(line, "HTTP/", 5)){
+        char *sp = memchr(line, ' ', len);
+        if(sp && strncmp(sp + 1, "304", 3)){
+            self->etag[0] = '\0';
+            self->last_modified[0] = '\0';
+        }
+        return len;
+    }
+    http_client_match_header(line, len, "ETag", self->etag, sizeof(self->etag));
+    http_client_match_header(line, len, "Last-Modified", self->last_modified, sizeof(self->last_modified));
+    return len;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+#include <stdbool.h>
+#include <curl/curl.h>
+
+#include "http-buffer.h"
+
+#define HTTP_CLIENT_CONNECT_TIMEOUT 2000 /*ms*/
+#define HTTP_CLIENT_TIMEOUT 5000 /*ms*/
+
+typedef enum{
+    HTTP_OK,            /*New content is in the buffer*/
+    HTTP_NOT_MODIFIED,  /*Server says nothing changed since last time*/
+    HTTP_PENDING,       /*Non-blocking mode: request still in flight*/
+    HTTP_ERROR
+}HttpResult;
+
+/* Repeatedly fetches the same resource over a kept-alive connection:
+ * the curl handles, and thus the connection and resolved address, live
+ * as long as the client. ETag/Last-Modified are sent back so that the
+ * server can skip unchanged content.
+ */
+typedef struct{
+    CURL *curl;
+    CURLM *multi;
+    struct curl_slist *headers;
+
+    HttpBuffer *buf;    /*Last response body, NULL-terminated*/
+    long status;
+    bool has_body;      /*The current response replaced buf*/
+
+    bool blocking;
+    bool in_flight;
+
+    char etag[128];
+    char last_modified[64];
+}HttpClient;
+
+HttpClient *http_client_new(const char *url);
+HttpClient *http_client_init(HttpClient *self, const char *url);
+HttpClient *http_client_dispose(HttpClient *self);
+void http_client_free(HttpClient *self);
+
+void http_client_set_timeouts(HttpClient *self, long connect_timeout, long timeout);
+void http_client_set_blocking(HttpClient *self, bool blocking);
+
+HttpResult http_client_get(HttpClient *self);
+#endif /* HTTP_CLIENT_H */
@@ -17,6 +17,7 @@ static void ladder_gauge_update_state(LadderGauge *self, Uint32 dt);
 static void ladder_gauge_render(LadderGauge *self, Uint32 dt, RenderContext *ctx);
 static void *ladder_gauge_dispose(LadderGauge *self);
 static BaseGaugeOps ladder_gauge_ops = {
+   .name = "LadderGauge",
    .render = (RenderFunc)ladder_gauge_render,
    .update_state = (StateUpdateFunc)ladder_gauge_update_state,
    .dispose = (DisposeFunc)ladder_gauge_dispose
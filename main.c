@@ -8,7 +8,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <pthread.h>
 
+#include <curl/curl.h>
 #include <SDL2/SDL.h>
 
 #include "base-gauge.h"
@@ -16,8 +18,12 @@
 #include "dialogs/direct-to-dialog.h"
 #include "side-panel.h"
 #include "map-gauge.h"
+#include "misc.h"
+#include "perf-counters.h"
+#include "perf-overlay.h"
 #include "resource-manager.h"
 #include "sdl-colors.h"
+#include "text-gauge.h"
 #include "widgets/base-widget.h"
 
 #if ENABLE_3D
@@ -29,6 +35,10 @@
 #define ENABLE_SENSORS 1
 #define ENABLE_STRATUX 1
 #define ENABLE_MOCK 1
+#define ENABLE_XPLANE 1
+#define ENABLE_REPLAY 1
+#define ENABLE_FUSED 1
+#define ENABLE_BROADCAST 1
 
 #include "data-source.h"
 #if ENABLE_FGCONN
@@ -46,30 +56,152 @@
 #if ENABLE_MOCK
 #include "mock-data-source.h"
 #endif
+#if ENABLE_XPLANE
+#include "xp-data-source.h"
+#endif
+#if ENABLE_REPLAY
+#include "flight-log-data-source.h"
+#endif
+#if ENABLE_FUSED
+#include "composite-data-source.h"
+#endif
+#if ENABLE_BROADCAST
+#include "broadcast-data-source.h"
+#include "data-publisher.h"
+#endif
 
 #define SCREEN_WIDTH 640
 #define SCREEN_HEIGHT 480
 
 #define N_COLORS 4
 
+#define TRACE_FILE "sofis-trace.json"
+
+/* Acquisition thread polling period, per source. 0 means polled from
+ * the main loop*/
+#define FGREMOTE_PERIOD 5 /*non-blocking socket*/
+#define STRATUX_PERIOD 50 /*blocking HTTP request*/
+#define STRATUX_WS_PERIOD 1 /*waits for the next push itself*/
+#define SENSORS_PERIOD 5 /*IMU rate, 200Hz*/
+#define XPLANE_PERIOD 5 /*non-blocking socket*/
+
+#define XPLANE_PORT 49000 /*Where X-Plane sends its data to*/
+#define XPLANE_RATE 30 /*RREF updates per second*/
+
+/* Attitude extrapolation past the last sample, for sources whose
+ * update rate is too low for a smooth display*/
+#define PREDICTION_HORIZON 500 /*ms*/
+
+#define DEFAULT_TAPE "fg-io/fg-tape/dr400.fgtape"
+#define BENCH_TAPE_STEP 40 /*Simulated ms per frame in --bench-tape mode*/
+#define TAPE_SEEK_STEP 10 /*s*/
+#define TAPE_MAX_SPEED 64
+
 typedef enum{
     MODE_FGREMOTE,
     MODE_FGTAPE,
     MODE_SENSORS,
     MODE_STRATUX,
     MODE_MOCK,
+    MODE_XPLANE,
+    MODE_REPLAY,
+    MODE_FUSED,
+    MODE_SUBSCRIBE,
     N_MODES
 }RunningMode;
 
+/* What it takes to bring up the DataSource, which is done on its own
+ * thread while the display comes up and runs: opening devices, sockets
+ * or tapes can take a while*/
+typedef struct{
+    char *tape_file;
+    char *stratux_host;
+    char *xplane_host;
+    char *sensors_replay;
+    char *sensors_record;
+    char *replay_file;
+    char *record_file;
+    char *subscribe_group;
+    char *publish_group;
+    bool publish;
+    StratuxTransport stratux_transport;
+
+    pthread_t tid;
+    bool threaded;
+    atomic_bool done; /*source is set, NULL on failure*/
+    DataSource *source;
+}SourceSetup;
+
 BasicHud *hud = NULL;
 SidePanel *panel = NULL;
 MapGauge *map = NULL;
 DirectToDialog *ddt = NULL;
+#if ENABLE_PERF_COUNTERS
+PerfOverlay *perf = NULL;
+#endif
+#if ENABLE_3D
+TerrainViewer *viewer = NULL;
+#endif
+DataPublisher *publisher = NULL;
 
 bool g_show3d = false;
+bool g_bench_tape = false;
 DataSource *g_ds;
 RunningMode g_mode;
 
+/* Tape playback controls:
+ * Left/Right: seek 10s backward/forward
+ * Up/Down: double/halve the playback speed
+ * r: reverse the playback direction
+ * l: set the loop start, then its end, then stop looping
+ * Return true if the key has been handled*/
+bool handle_tape_keyboard(FGTapeDataSource *tape, SDL_KeyboardEvent *event)
+{
+    static double loop_mark = -1;
+    float speed;
+
+    if(event->state != SDL_PRESSED)
+        return false;
+
+    switch(event->keysym.sym){
+        case SDLK_LEFT:
+            fg_tape_data_source_seek(tape, tape->position - TAPE_SEEK_STEP);
+            break;
+        case SDLK_RIGHT:
+            fg_tape_data_source_seek(tape, tape->position + TAPE_SEEK_STEP);
+            break;
+        case SDLK_UP:
+        case SDLK_DOWN:
+            speed = (event->keysym.sym == SDLK_UP) ? tape->speed * 2 : tape->speed / 2;
+            if(fabsf(speed) > TAPE_MAX_SPEED || fabsf(speed) < 1.0/TAPE_MAX_SPEED)
+                break;
+            fg_tape_data_source_set_speed(tape, speed);
+            printf("\nTape speed: %gx\n", speed);
+            break;
+        case SDLK_r:
+            fg_tape_data_source_set_speed(tape, -tape->speed);
+            tape->playing = true;
+            printf("\nTape speed: %gx\n", tape->speed);
+            break;
+        case SDLK_l:
+            if(tape->loop_end > tape->loop_start){
+                fg_tape_data_source_set_loop(tape, 0, 0);
+                printf("\nTape loop off\n");
+            }else if(loop_mark < 0){
+                loop_mark = tape->position;
+                printf("\nTape loop start: %.1fs\n", loop_mark);
+            }else{
+                fg_tape_data_source_set_loop(tape, fmin(loop_mark, tape->position), fmax(loop_mark, tape->position));
+                printf("\nTape loop: %.1fs-%.1fs\n", tape->loop_start, tape->loop_end);
+                loop_mark = -1;
+            }
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
 /*Return true to quit the app*/
 bool handle_keyboard(SDL_KeyboardEvent *event, Uint32 elapsed)
 {
@@ -78,11 +210,19 @@ bool handle_keyboard(SDL_KeyboardEvent *event, Uint32 elapsed)
     bool attitude_dirty = false;
     bool location_dirty = false;
 
+    if(!g_ds) /*Still starting up*/
+        return event->keysym.sym == SDLK_ESCAPE && event->state == SDL_PRESSED;
+
     new_attitude = g_ds->attitude;
     new_location = g_ds->location;
+    /*Will be stamped as new samples*/
+    new_attitude.timestamp = 0;
+    new_location.timestamp = 0;
 
     if(ddt && ddt->visible)
         base_widget_handle_event(BASE_WIDGET(ddt), event);
+    if(g_mode == MODE_FGTAPE && handle_tape_keyboard((FGTapeDataSource*)g_ds, event))
+        return false;
 
     switch(event->keysym.sym){
         /*App control*/
@@ -99,6 +239,8 @@ bool handle_keyboard(SDL_KeyboardEvent *event, Uint32 elapsed)
             if(event->state == SDL_PRESSED){
                 if(g_mode == MODE_FGTAPE)
                     ((FGTapeDataSource*)(g_ds))->playing = !((FGTapeDataSource*)(g_ds))->playing;
+                else if(g_mode == MODE_REPLAY)
+                    ((FlightLogDataSource*)(g_ds))->playing = !((FlightLogDataSource*)(g_ds))->playing;
             }
             break;
         case SDLK_p:
@@ -109,6 +251,23 @@ bool handle_keyboard(SDL_KeyboardEvent *event, Uint32 elapsed)
                 );
             }
             break;
+#if ENABLE_PERF_COUNTERS
+        /*Instrumentation*/
+        case SDLK_F3:
+            if(event->state == SDL_PRESSED)
+                perf->visible = !perf->visible;
+            break;
+        case SDLK_F4:
+            if(event->state == SDL_PRESSED){
+                if(perf_counters_tracing()){
+                    perf_counters_stop_trace();
+                    printf("\nTrace written to %s\n", TRACE_FILE);
+                }else{
+                    perf_counters_start_trace(TRACE_FILE);
+                }
+            }
+            break;
+#endif
 
         /*MapGauge controls*/
         case SDLK_KP_8: /*keypad up arrows*/
@@ -253,6 +412,14 @@ const char *pretty_mode(RunningMode mode)
             return "StratuxDataSource";
         case MODE_MOCK:
             return "MockDataSource";
+        case MODE_XPLANE:
+            return "XPDataSource";
+        case MODE_REPLAY:
+            return "FlightLogDataSource";
+        case MODE_FUSED:
+            return "CompositeDataSource";
+        case MODE_SUBSCRIBE:
+            return "BroadcastDataSource";
 
         default:
             return "Unknown!";
@@ -275,8 +442,195 @@ void update_terrain_viewer_attitude(TerrainViewer *self, AttitudeData *newv)
     plane_set_attitude(self->plane, newv->roll, newv->pitch, newv->heading);
     self->dirty = true;
 }
+
+void update_terrain_viewer(TerrainViewer *self, uint32_t changed, const DataFrame *frame)
+{
+    if(changed & DATA_CHANGED(LOCATION_DATA))
+        update_terrain_viewer_location(self, (LocationData*)&frame->location);
+    if(changed & DATA_CHANGED(ATTITUDE_DATA))
+        update_terrain_viewer_attitude(self, (AttitudeData*)&frame->attitude);
+}
 #endif
 
+/* Creates the DataSource and starts the acquisition, from the startup
+ * thread. The rendering thread picks it up once done, see
+ * attach_data_source.*/
+void *setup_data_source(SourceSetup *setup)
+{
+    DataSource *ds = NULL;
+    uint32_t acq_period = 0;
+    bool predict = false;
+
+    switch(g_mode){
+        case MODE_SENSORS:
+            ds = (DataSource *)sensors_data_source_new(setup->sensors_replay);
+            if(ds && setup->sensors_record && !sensors_data_source_record((SensorsDataSource*)ds, setup->sensors_record))
+                printf("Couldn't record sensor readings to %s\n", setup->sensors_record);
+            acq_period = SENSORS_PERIOD;
+            break;
+        case MODE_FGREMOTE:
+            ds = (DataSource *)fg_data_source_new(6789);
+            acq_period = FGREMOTE_PERIOD;
+            predict = true; /*5Hz*/
+            break;
+        case MODE_STRATUX:
+            ds = (DataSource *)stratux_data_source_new(setup->stratux_host, setup->stratux_transport);
+            acq_period = (setup->stratux_transport == STRATUX_WEBSOCKET) ? STRATUX_WS_PERIOD : STRATUX_PERIOD;
+            predict = true;
+            break;
+        case MODE_MOCK:
+            ds = (DataSource*)mock_data_source_new();
+            break;
+        case MODE_XPLANE:
+            ds = (DataSource *)xp_data_source_new(XPLANE_PORT);
+            if(ds && setup->xplane_host && !xp_data_source_subscribe((XPDataSource*)ds, setup->xplane_host, XPLANE_RATE))
+                printf("Couldn't subscribe to X-Plane datarefs, relying on its Data Output settings\n");
+            acq_period = XPLANE_PERIOD;
+            predict = true;
+            break;
+        case MODE_REPLAY:
+            ds = (DataSource *)flight_log_data_source_new(setup->replay_file);
+            break;
+        case MODE_FUSED:
+            /* Attitude from the IMU, backed by the Stratux AHRS, position
+             * from the Stratux GPS backed by gpsd. Children run on their
+             * own threads*/
+            ds = (DataSource *)composite_data_source_new();
+            if(!ds)
+                break;
+            composite_data_source_add((CompositeDataSource*)ds, "sensors",
+                (DataSource *)sensors_data_source_new(setup->sensors_replay), SENSORS_PERIOD, 3,
+                ATTITUDE_DATA, 2,
+                DYNAMICS_DATA, 2,
+                LOCATION_DATA, 1
+            );
+            composite_data_source_add((CompositeDataSource*)ds, "stratux",
+                (DataSource *)stratux_data_source_new(setup->stratux_host, setup->stratux_transport),
+                STRATUX_WS_PERIOD, 3,
+                LOCATION_DATA, 2,
+                ATTITUDE_DATA, 1,
+                DYNAMICS_DATA, 1
+            );
+            if(!((CompositeDataSource*)ds)->nchildren)
+                ds = data_source_free(ds);
+            break;
+        case MODE_SUBSCRIBE:
+            /*Non-blocking, polled from the main loop*/
+            ds = (DataSource *)broadcast_data_source_new(setup->subscribe_group, 0);
+            break;
+        case MODE_FGTAPE: //Fallthtough
+        default:
+            ds = (DataSource *)fg_tape_data_source_new(setup->tape_file, g_bench_tape ? 0 : 120);
+            if(ds && g_bench_tape)
+                fg_tape_data_source_set_fixed_step((FGTapeDataSource*)ds, BENCH_TAPE_STEP);
+            break;
+    }
+
+    if(ds){
+        data_source_set_deadbands(ds, &data_source_display_deadbands);
+        if(setup->record_file && !data_source_record(ds, setup->record_file))
+            printf("Couldn't record to %s, going on without\n", setup->record_file);
+        if(predict && !data_source_set_prediction(ds, PREDICTION_HORIZON))
+            printf("Couldn't setup attitude prediction, going on without\n");
+        if(acq_period && !data_source_start_acquisition(ds, acq_period))
+            printf("Couldn't start acquisition thread, polling from the main loop\n");
+    }
+
+    setup->source = ds;
+    atomic_store(&setup->done, true);
+    return ds;
+}
+
+/**
+ * @brief Makes the source built by setup_data_source the global one, and
+ * hooks the gauges up to it. Rendering thread only.
+ *
+ * @param wait Wait for the startup thread rather than returning false
+ * when it isn't done yet
+ * @return true once attached
+ */
+bool attach_data_source(SourceSetup *setup, bool wait)
+{
+    if(!wait && !atomic_load(&setup->done))
+        return false;
+    if(setup->threaded)
+        pthread_join(setup->tid, NULL);
+
+    g_ds = setup->source;
+    if(!g_ds){
+        printf("Couldn't create DataSource (%s), bailing out\n", pretty_mode(g_mode));
+        exit(EXIT_FAILURE);
+    }
+    data_source_set(g_ds);
+    if(setup->publish){
+        publisher = data_publisher_new(g_ds, setup->publish_group, 0);
+        if(!publisher)
+            printf("Couldn't publish data to other displays, going on without\n");
+    }
+
+    if(g_mode == MODE_FGREMOTE)
+        fg_data_source_banner((FGDataSource*)g_ds);
+
+    data_source_add_frame_listener(g_ds, &(FrameListener){
+        .callback = (FrameListenerFunc)basic_hud_frame_changed,
+        .target = hud,
+        .mask = DATA_CHANGED(ATTITUDE_DATA) | DATA_CHANGED(DYNAMICS_DATA) | DATA_CHANGED(LOCATION_DATA),
+        .priority = 1 /*Primary flight instruments first*/
+    });
+
+    data_source_add_listener(g_ds, ENGINE_DATA, &(ValueListener){
+        .callback = (ValueListenerFunc)side_panel_engine_data_changed,
+        .target = panel
+    });
+
+    data_source_add_frame_listener(g_ds, &(FrameListener){
+        .callback = (FrameListenerFunc)map_gauge_frame_changed,
+        .target = map,
+        .mask = DATA_CHANGED(LOCATION_DATA) | DATA_CHANGED(ATTITUDE_DATA) | DATA_CHANGED(ROUTE_DATA),
+        /*The period is wall-clock time: benchmarks would then depend on
+         * the machine speed*/
+        .period = g_bench_tape ? 0 : MAP_UPDATE_PERIOD
+    });
+
+#if ENABLE_3D
+    data_source_add_frame_listener(g_ds, &(FrameListener){
+        .callback = (FrameListenerFunc)update_terrain_viewer,
+        .target = viewer,
+        .mask = DATA_CHANGED(LOCATION_DATA) | DATA_CHANGED(ATTITUDE_DATA)
+    });
+#endif
+    data_source_print_listener_stats(g_ds);
+    return true;
+}
+
+/* Flags the gauges that have nothing to show yet: attitude, airspeed,
+ * altitude and the map*/
+void render_no_data(TextGauge *flag, Uint32 elapsed, RenderTarget rtarget, SDL_Rect *maprect)
+{
+    SDL_Rect spots[] = {
+        {SCREEN_WIDTH/2, SCREEN_HEIGHT/2, 0, 0},
+        {
+            hud->locations[SPEED].x + base_gauge_w(BASE_GAUGE(hud->airspeed))/2,
+            hud->locations[SPEED].y + base_gauge_h(BASE_GAUGE(hud->airspeed))/2,
+            0, 0
+        },
+        {
+            hud->locations[ALT_GROUP].x + base_gauge_w(BASE_GAUGE(hud->altgroup))/2,
+            hud->locations[ALT_GROUP].y + base_gauge_h(BASE_GAUGE(hud->altgroup))/2,
+            0, 0
+        },
+        {maprect->x + maprect->w/2, maprect->y + maprect->h/2, 0, 0}
+    };
+
+    for(int i = 0; i < sizeof(spots)/sizeof(spots[0]); i++){
+        spots[i].x -= base_gauge_w(BASE_GAUGE(flag))/2;
+        spots[i].y -= base_gauge_h(BASE_GAUGE(flag))/2;
+        spots[i].w = base_gauge_w(BASE_GAUGE(flag));
+        spots[i].h = base_gauge_h(BASE_GAUGE(flag));
+        base_gauge_render(BASE_GAUGE(flag), elapsed, &(RenderContext){rtarget, &spots[i], NULL});
+    }
+}
+
 int main(int argc, char **argv)
 {
     Uint32 colors[N_COLORS];
@@ -284,45 +638,90 @@ int main(int argc, char **argv)
     int i;
     float oldv[5] = {0,0,0,0,0};
     RenderTarget rtarget;
+    SourceSetup setup = {
+        .tape_file = DEFAULT_TAPE,
+        .stratux_transport = STRATUX_WEBSOCKET
+    };
+    TextGauge *no_data;
+    bool has_fix = false;
+    uint64_t launch_ns = monotonic_ns();
 
     g_mode = MODE_FGTAPE;
     if(argc > 1){
         if(!strcmp(argv[1], "--sensors"))
             g_mode = MODE_SENSORS;
-        else if(!strcmp(argv[1], "--fgtape"))
+        else if(!strcmp(argv[1], "--sensors-replay") && argc > 2){
+            g_mode = MODE_SENSORS;
+            setup.sensors_replay = argv[2];
+        }
+        else if(!strcmp(argv[1], "--sensors-record") && argc > 2){
+            g_mode = MODE_SENSORS;
+            setup.sensors_record = argv[2];
+        }
+        else if(!strcmp(argv[1], "--fgtape")){
             g_mode = MODE_FGTAPE;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.tape_file = argv[2];
+        }
         else if(!strcmp(argv[1], "--fgremote"))
             g_mode = MODE_FGREMOTE;
-        else if(!strcmp(argv[1], "--stratux"))
+        else if(!strcmp(argv[1], "--stratux") || !strcmp(argv[1], "--stratux-http")){
             g_mode = MODE_STRATUX;
+            if(!strcmp(argv[1], "--stratux-http"))
+                setup.stratux_transport = STRATUX_HTTP;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.stratux_host = argv[2];
+        }
         else if(!strcmp(argv[1], "--mock"))
             g_mode = MODE_MOCK;
+        else if(!strcmp(argv[1], "--xplane")){
+            g_mode = MODE_XPLANE;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.xplane_host = argv[2];
+        }
+        else if(!strcmp(argv[1], "--fused")){
+            g_mode = MODE_FUSED;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.stratux_host = argv[2];
+        }
+        else if(!strcmp(argv[1], "--subscribe")){
+            g_mode = MODE_SUBSCRIBE;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.subscribe_group = argv[2];
+        }
+        else if(!strcmp(argv[1], "--replay") && argc > 2){
+            g_mode = MODE_REPLAY;
+            setup.replay_file = argv[2];
+        }
+        else if(!strcmp(argv[1], "--bench-tape")){
+            g_mode = MODE_FGTAPE;
+            g_bench_tape = true;
+            if(argc > 2 && strncmp(argv[2], "--", 2))
+                setup.tape_file = argv[2];
+        }
     }
 
-    switch(g_mode){
-        case MODE_SENSORS:
-            g_ds = (DataSource *)sensors_data_source_new();
-            break;
-        case MODE_FGREMOTE:
-            g_ds = (DataSource *)fg_data_source_new(6789);
-            break;
-        case MODE_STRATUX:
-            g_ds = (DataSource *)stratux_data_source_new();
-            break;
-        case MODE_MOCK:
-            g_ds = (DataSource*)mock_data_source_new();
-            break;
-        case MODE_FGTAPE: //Fallthtough
-        default:
-            g_ds = (DataSource *)fg_tape_data_source_new("fg-io/fg-tape/dr400.fgtape", 120);
-            break;
+    /*Goes along with any mode*/
+    for(i = 1; i < argc - 1; i++){
+        if(!strcmp(argv[i], "--record"))
+            setup.record_file = argv[i+1];
     }
-
-    if(!g_ds){
-        printf("Couldn't create DataSource (%s), bailing out\n", pretty_mode(g_mode));
-        exit(EXIT_FAILURE);
+    for(i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--publish")){
+            setup.publish = true;
+            if(i < argc - 1 && strncmp(argv[i+1], "--", 2))
+                setup.publish_group = argv[i+1];
+        }
     }
-    data_source_set(g_ds);
+
+    /* Acquisition gets going while fonts, ladder pages and map tiles are
+     * loaded, and the display runs. Textures have to be made on this
+     * thread anyway*/
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    atomic_init(&setup.done, false);
+    setup.threaded = !pthread_create(&setup.tid, NULL, (void*)setup_data_source, &setup);
+    if(!setup.threaded)
+        setup_data_source(&setup);
 
 #if USE_SDL_GPU
     GPU_Target* gpu_screen = NULL;
@@ -381,6 +780,16 @@ int main(int argc, char **argv)
     map->level = 7;
     SDL_Rect maprect = {SCREEN_WIDTH-200,SCREEN_HEIGHT-160,base_gauge_w(BASE_GAUGE(map)),base_gauge_h(BASE_GAUGE(map))};
 
+#if ENABLE_PERF_COUNTERS
+    perf = perf_overlay_new();
+    SDL_Rect perfrect = {
+        SCREEN_WIDTH - base_gauge_w(BASE_GAUGE(perf)) - 4,
+        4,
+        base_gauge_w(BASE_GAUGE(perf)),
+        base_gauge_h(BASE_GAUGE(perf))
+    };
+#endif
+
     SDL_Rect ddtrect ={
         640/2,
         480/2 - 100,
@@ -389,10 +798,21 @@ int main(int argc, char **argv)
     };
 
 #if ENABLE_3D
-    TerrainViewer *viewer;
     viewer = terrain_viewer_new(-0.2);
 #endif
 
+    /*Over the gauges until the source has its first fix*/
+    no_data = text_gauge_new(NULL, true, 68, 20);
+    no_data->alignment = HALIGN_CENTER | VALIGN_MIDDLE;
+    text_gauge_set_static_font(no_data,
+        resource_manager_get_static_font(TERMINUS_12,
+            &SDL_RED,
+            1, "NO DATA"
+        )
+    );
+    text_gauge_set_color(no_data, SDL_BLACK, BACKGROUND_COLOR);
+    text_gauge_set_value(no_data, "NO DATA");
+
     done = false;
     Uint32 ticks;
     Uint32 last_ticks = 0;
@@ -410,64 +830,51 @@ int main(int argc, char **argv)
 #endif
     hud->attitude->mode = (g_show3d) ? AI_MODE_3D : AI_MODE_2D;
 
-    if(g_mode == MODE_FGREMOTE)
-        fg_data_source_banner((FGDataSource*)g_ds);
-
-    data_source_add_events_listener(g_ds, hud, 3,
-        ATTITUDE_DATA, basic_hud_attitude_changed,
-        DYNAMICS_DATA, basic_hud_dynamics_changed,
-        LOCATION_DATA, basic_hud_location_changed
-    );
-
-    data_source_add_listener(g_ds, ENGINE_DATA, &(ValueListener){
-        .callback = (ValueListenerFunc)side_panel_engine_data_changed,
-        .target = panel
-    });
-
-    data_source_add_events_listener(g_ds, map, 3,
-        LOCATION_DATA, map_gauge_location_changed,
-        ATTITUDE_DATA, map_gauge_attitude_changed,
-        ROUTE_DATA, map_gauge_route_changed
-    );
-
-#if ENABLE_3D
-    data_source_add_events_listener(g_ds, viewer, 2,
-        LOCATION_DATA, update_terrain_viewer_location,
-        ATTITUDE_DATA, update_terrain_viewer_attitude
-    );
-#endif
-    data_source_print_listener_stats(g_ds);
-
-    printf("Waiting for fix.");
-    do{
-        data_source_frame(DATA_SOURCE(g_ds), 0);
-        printf(".");
-        fflush(stdout);
-        sleep(1); /*sleep for 1 sec*/
-    }while(!DATA_SOURCE(g_ds)->has_fix);
-    printf("\n");
-
+    /*Benchmarks start with the tape loaded*/
+    if(g_bench_tape)
+        attach_data_source(&setup, true);
 
+    uint64_t bench_start = monotonic_ns();
     last_dtms = 0;
     startms = SDL_GetTicks();
     do{
         ticks = SDL_GetTicks();
         elapsed = ticks - last_ticks;
         dtms = ticks - startms;
+        if(g_bench_tape){
+            /* Gauges animations must follow the simulated time, otherwise
+             * the amount of work done per frame would depend on the machine
+             * speed*/
+            elapsed = BENCH_TAPE_STEP;
+        }
 
+        PERF_FRAME_BEGIN();
         done = handle_events(elapsed);
 
-        if(data_source_frame(DATA_SOURCE(g_ds), dtms - last_dtms)){
+        PERF_BEGIN("data_source");
+        /*The gauges are flagged until the source is up, and has a fix*/
+        bool ds_updated = false;
+        if(!g_ds && attach_data_source(&setup, false))
+            last_dtms = dtms; /*The time spent setting it up is not to be played*/
+        if(g_ds)
+            ds_updated = data_source_frame(DATA_SOURCE(g_ds), dtms - last_dtms);
+        if(publisher)
+            data_publisher_tick(publisher);
+        PERF_END();
+        if(ds_updated){
             last_dtms = dtms;
-
+        }
+        if(!has_fix && g_ds && DATA_SOURCE(g_ds)->has_fix){
+            has_fix = true;
+            printf("Got fix after %llums\n", (unsigned long long)(monotonic_ns() - launch_ns) / 1000000);
 #if ENABLE_3D
-            if(last_ticks == 0){ //Do an invisible frame to trigger preload
-                GPU_FlushBlitBuffer(); /*begin 3*/
-                terrain_viewer_frame(viewer);
-                GPU_ResetRendererState(); /*end 3d*/
-                /*Reset startms as initial loading can take up a while*/
-                startms = SDL_GetTicks();
-            }
+            //Do an invisible frame to trigger preload
+            GPU_FlushBlitBuffer(); /*begin 3*/
+            terrain_viewer_frame(viewer);
+            GPU_ResetRendererState(); /*end 3d*/
+            /*Reset startms as initial loading can take up a while*/
+            startms = SDL_GetTicks();
+            last_dtms = 0;
 #endif
         }
 #if USE_SDL_GPU
@@ -484,21 +891,46 @@ int main(int argc, char **argv)
         }
 #endif
         render_start = SDL_GetTicks();
+        PERF_BEGIN("gauges");
         base_gauge_render(BASE_GAUGE(hud), elapsed, &(RenderContext){rtarget, &whole, NULL});
         base_gauge_render(BASE_GAUGE(panel), elapsed, &(RenderContext){rtarget, &sprect, NULL});
         base_gauge_render(BASE_GAUGE(map), elapsed, &(RenderContext){rtarget, &maprect, NULL});
+        if(!has_fix)
+            render_no_data(no_data, elapsed, rtarget, &maprect);
         if(ddt && ddt->visible)
             base_gauge_render(BASE_GAUGE(ddt), elapsed, &(RenderContext){rtarget, &ddtrect, NULL});
+        PERF_END();
         render_end = SDL_GetTicks();
         total_render_time += render_end - render_start;
         nrender_calls++;
+#if ENABLE_PERF_COUNTERS
+        /*Kept out of the "gauges" scope so that it doesn't account for itself*/
+        if(perf->visible)
+            base_gauge_render(BASE_GAUGE(perf), elapsed, &(RenderContext){rtarget, &perfrect, NULL});
+#endif
 
+        PERF_BEGIN("flip");
 #if USE_SDL_GPU
 		GPU_Flip(gpu_screen);
 #else
         SDL_UpdateWindowSurface(window);
 #endif
+        PERF_END();
+        if(nframes == 0 && last_ticks == 0)
+            printf("First frame up after %llums\n", (unsigned long long)(monotonic_ns() - launch_ns) / 1000000);
+#if ENABLE_PERF_COUNTERS
+        uint64_t acquired = g_ds ? data_source_displayed(g_ds) : 0;
+        if(acquired)
+            PERF_LATENCY(monotonic_ns() - acquired);
+#endif
+        PERF_FRAME_END();
         nframes++;
+        if(g_bench_tape){
+            /*Run as fast as possible, until the end of the tape*/
+            done = done || ((FGTapeDataSource*)g_ds)->ended;
+            last_ticks = ticks;
+            continue;
+        }
         acc += elapsed;
         if(elapsed < 20){
             SDL_Delay(20 - elapsed);
@@ -522,11 +954,37 @@ int main(int argc, char **argv)
     }while(!done);
 
     printf("Average rendering time (%d samples): %f ticks\n", nrender_calls, total_render_time*1.0/nrender_calls);
+    if(g_bench_tape){
+        double secs = (monotonic_ns() - bench_start) / 1000000000.0;
+        printf("Replayed %s: %u frames (%.1fs of tape) in %.3fs, %.1f fps\n",
+            setup.tape_file, nframes, nframes * BENCH_TAPE_STEP / 1000.0,
+            secs, nframes / secs
+        );
+#if ENABLE_PERF_COUNTERS
+        perf_counters_dump_totals(stdout);
+#endif
+    }
+#if ENABLE_PERF_COUNTERS
+    perf_counters_dump(stdout);
+    perf_counters_stop_trace();
+    base_gauge_free(BASE_GAUGE(perf));
+#endif
     base_gauge_free(BASE_GAUGE(hud));
     base_gauge_free(BASE_GAUGE(panel));
     base_gauge_free(BASE_GAUGE(map));
-    data_source_free(DATA_SOURCE(g_ds));
+    base_gauge_free(BASE_GAUGE(no_data));
+    if(publisher)
+        data_publisher_free(publisher);
+    if(!g_ds){
+        /*Quit before the source was up*/
+        if(setup.threaded)
+            pthread_join(setup.tid, NULL);
+        g_ds = setup.source;
+    }
+    if(g_ds)
+        data_source_free(DATA_SOURCE(g_ds));
     resource_manager_shutdown();
+    curl_global_cleanup();
 #if ENABLE_3D
     terrain_viewer_free(viewer);
     texture_store_shutdown();
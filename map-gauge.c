@@ -53,6 +53,7 @@ static void map_gauge_render(MapGauge *self, Uint32 dt, RenderContext *ctx);
 static void map_gauge_update_state(MapGauge *self, Uint32 dt);
 static MapGauge *map_gauge_dispose(MapGauge *self);
 static BaseGaugeOps map_gauge_ops = {
+   .name = "MapGauge",
    .render = (RenderFunc)map_gauge_render,
    .update_state = (StateUpdateFunc)map_gauge_update_state,
    .dispose = (DisposeFunc)map_gauge_dispose
@@ -491,6 +492,16 @@ void map_gauge_route_changed(MapGauge *self, RouteData *newv)
     BASE_GAUGE(self)->dirty = true;
 }
 
+void map_gauge_frame_changed(MapGauge *self, uint32_t changed, const DataFrame *frame)
+{
+    if(changed & DATA_CHANGED(LOCATION_DATA))
+        map_gauge_location_changed(self, (LocationData*)&frame->location);
+    if(changed & DATA_CHANGED(ATTITUDE_DATA))
+        map_gauge_attitude_changed(self, (AttitudeData*)&frame->attitude);
+    if(changed & DATA_CHANGED(ROUTE_DATA))
+        map_gauge_route_changed(self, (RouteData*)&frame->route);
+}
+
 /*TODO: split up*/
 static void map_gauge_update_state(MapGauge *self, Uint32 dt)
 {
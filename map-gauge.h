@@ -21,6 +21,7 @@
  * of level 23
  */
 #define MAP_GAUGE_MAX_LEVEL 23
+#define MAP_UPDATE_PERIOD 500 /*ms, the marker moves a few pixels at most in between*/
 
 typedef struct{
     /*TODO: Array of pointers to layers, as much as providers/overlays*/
@@ -96,4 +97,5 @@ bool map_gauge_set_viewport(MapGauge *self, int32_t x, int32_t y, bool animated)
 void map_gauge_location_changed(MapGauge *self, LocationData *newv);
 void map_gauge_attitude_changed(MapGauge *self, AttitudeData *newv);
 void map_gauge_route_changed(MapGauge *self, RouteData *newv);
+void map_gauge_frame_changed(MapGauge *self, uint32_t changed, const DataFrame *frame);
 #endif /* MAP_GAUGE_H */
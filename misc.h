@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #include "SDL_rect.h"
 
@@ -67,4 +68,13 @@ static inline float clampf(float x, float low, float high)
 {
     return (x > high) ? high : ((x < low) ? low : x);
 }
+
+/*Monotonic time in nanoseconds, arbitrary origin*/
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 #endif /* MISC_H */
@@ -72,7 +72,7 @@ static bool mock_data_source_frame(MockDataSource *self, uint32_t dt)
         }
     );
 
-    DATA_SOURCE(self)->has_fix = true;
+    data_source_set_fix(DATA_SOURCE(self));
     return true;
 }
 
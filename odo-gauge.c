@@ -21,6 +21,7 @@ static void odo_gauge_render(OdoGauge *self, Uint32 dt, RenderContext *ctx);
 static void odo_gauge_update_state(OdoGauge *self, Uint32 dt);
 static void *odo_gauge_dispose(OdoGauge *self);
 static BaseGaugeOps odo_gauge_ops = {
+   .name = "OdoGauge",
    .render = (RenderFunc)odo_gauge_render,
    .update_state = (StateUpdateFunc)odo_gauge_update_state,
    .dispose = (DisposeFunc)odo_gauge_dispose
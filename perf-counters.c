@@ -0,0 +1,380 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "misc.h"
+#include "perf-counters.h"
+
+/* Single instance, only to be used from the rendering thread: there
+ * is no locking whatsoever.
+ */
+static PerfCounters _perf_counters = {0};
+
+static PerfCounter *perf_counters_lookup(PerfCounters *self, const char *name,
+                                         const char *parent, uint8_t depth);
+static void perf_counters_publish(PerfCounters *self, uint64_t now);
+static void perf_counters_write_trace(PerfCounters *self);
+static void perf_histogram_add(PerfHistogram *self, uint64_t ns);
+static void perf_histogram_dump(PerfHistogram *self, FILE *stream);
+
+PerfCounters *perf_counters_get_instance(void)
+{
+    return &_perf_counters;
+}
+
+/**
+ * @brief Opens a new timed scope, nested into the currently
+ * opened one (if any).
+ *
+ * @param name Scope name. Must outlive the counters (i.e string literal or
+ * static storage) as only the pointer is kept.
+ */
+void perf_counters_begin(const char *name)
+{
+    PerfCounters *self = &_perf_counters;
+
+    if(self->depth >= PERF_MAX_DEPTH){
+        /*Still count the level so that the matching end is a no-op*/
+        self->depth++;
+        return;
+    }
+
+    self->stack[self->depth].name = name;
+    self->stack[self->depth].start_ns = monotonic_ns();
+    self->depth++;
+}
+
+void perf_counters_end(void)
+{
+    PerfCounters *self = &_perf_counters;
+    PerfCounter *counter;
+    uint64_t duration;
+    uint8_t depth;
+
+    if(!self->depth){
+        printf("%s: unbalanced call, ignoring\n", __FUNCTION__);
+        return;
+    }
+    self->depth--;
+    depth = self->depth;
+    if(depth >= PERF_MAX_DEPTH)
+        return;
+
+    duration = monotonic_ns() - self->stack[depth].start_ns;
+
+    counter = perf_counters_lookup(self,
+        self->stack[depth].name,
+        depth ? self->stack[depth-1].name : NULL,
+        depth
+    );
+    if(counter){
+        counter->acc_ns += duration;
+        counter->acc_count++;
+        if(duration > counter->acc_max_ns)
+            counter->acc_max_ns = duration;
+        counter->total_ns += duration;
+        counter->total_calls++;
+    }
+
+    if(self->nevents < PERF_MAX_EVENTS){
+        self->events[self->nevents++] = (PerfEvent){
+            .name = self->stack[depth].name,
+            .depth = depth,
+            .start_ns = self->stack[depth].start_ns,
+            .duration_ns = duration,
+            .counter = counter
+        };
+    }else{
+        self->dropped++;
+    }
+}
+
+void perf_counters_frame_begin(void)
+{
+    PerfCounters *self = &_perf_counters;
+    uint64_t now;
+
+    now = monotonic_ns();
+    if(!self->origin_ns){
+        self->origin_ns = now;
+        self->window_start_ns = now;
+    }
+    self->nevents = 0;
+    perf_counters_begin("frame");
+}
+
+void perf_counters_frame_end(void)
+{
+    PerfCounters *self = &_perf_counters;
+    uint64_t now;
+
+    perf_counters_end(); /*frame*/
+    if(self->depth){
+        printf("%s: %d scope(s) left open during frame\n", __FUNCTION__, self->depth);
+        self->depth = 0;
+    }
+
+    if(self->trace)
+        perf_counters_write_trace(self);
+
+    self->window_frames++;
+    self->total_frames++;
+    now = monotonic_ns();
+    if(now - self->window_start_ns >= PERF_WINDOW_MS * 1000000ULL)
+        perf_counters_publish(self, now);
+}
+
+/**
+ * @brief Records the time between the acquisition of a sample and the
+ * moment it has been put on screen.
+ *
+ * @param ns Latency, nanoseconds
+ */
+void perf_counters_record_latency(uint64_t ns)
+{
+    PerfCounters *self = &_perf_counters;
+
+    perf_histogram_add(&self->latency_acc, ns);
+    perf_histogram_add(&self->latency_total, ns);
+}
+
+/**
+ * @brief Gets the latency under which @p pct percent of the
+ * samples are. Resolution is PERF_LATENCY_STEP_MS.
+ *
+ * @return The upper bound of the matching bucket, in ms. 0 when
+ * there are no samples.
+ */
+double perf_histogram_percentile(PerfHistogram *self, double pct)
+{
+    uint64_t target, acc;
+
+    if(!self->count)
+        return 0;
+
+    target = (self->count * pct + 99) / 100;
+    acc = 0;
+    for(int i = 0; i < PERF_LATENCY_BUCKETS - 1; i++){
+        acc += self->buckets[i];
+        if(acc >= target)
+            return (i + 1) * PERF_LATENCY_STEP_MS;
+    }
+    return self->max_ns / 1000000.0;
+}
+
+/**
+ * @brief Starts recording every scope into @p filename, using
+ * the Chrome trace event format (load it with chrome://tracing or
+ * https://ui.perfetto.dev).
+ */
+bool perf_counters_start_trace(const char *filename)
+{
+    PerfCounters *self = &_perf_counters;
+
+    if(self->trace)
+        perf_counters_stop_trace();
+
+    self->trace = fopen(filename, "w");
+    if(!self->trace){
+        printf("%s: couldn't open %s for writing\n", __FUNCTION__, filename);
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", self->trace);
+    self->trace_first = true;
+    return true;
+}
+
+void perf_counters_stop_trace(void)
+{
+    PerfCounters *self = &_perf_counters;
+
+    if(!self->trace)
+        return;
+    fputs("\n]}\n", self->trace);
+    fclose(self->trace);
+    self->trace = NULL;
+}
+
+/**
+ * @brief Gets the counters sorted by decreasing per-frame time.
+ *
+ * @param dst Where to store pointers to the counters
+ * @param ndst Size of @p dst
+ * @param max_depth Only consider counters whose nesting level is
+ * at most @p max_depth (0 being the frame itself)
+ * @return The number of counters stored in @p dst
+ */
+size_t perf_counters_sorted(PerfCounter **dst, size_t ndst, uint8_t max_depth)
+{
+    PerfCounters *self = &_perf_counters;
+    size_t n = 0;
+
+    for(int i = 0; i < self->ncounters; i++){
+        PerfCounter *c = &self->counters[i];
+        size_t j;
+
+        if(c->depth > max_depth || !c->calls)
+            continue;
+        /*insertion sort, there are only a handful of counters*/
+        for(j = 0; j < n && dst[j]->avg_ns >= c->avg_ns; j++);
+        if(j == ndst)
+            continue;
+        if(n < ndst)
+            n++;
+        for(size_t k = n-1; k > j; k--)
+            dst[k] = dst[k-1];
+        dst[j] = c;
+    }
+    return n;
+}
+
+void perf_counters_dump(FILE *stream)
+{
+    PerfCounters *self = &_perf_counters;
+
+    fprintf(stream, "%-28s %-20s %10s %10s %6s\n",
+        "scope", "parent", "avg(us)", "max(us)", "calls"
+    );
+    for(int i = 0; i < self->ncounters; i++){
+        PerfCounter *c = &self->counters[i];
+        fprintf(stream, "%*s%-*s %-20s %10.1f %10.1f %6u\n",
+            c->depth, "", 28 - c->depth, c->name,
+            c->parent ? c->parent : "-",
+            c->avg_ns / 1000.0,
+            c->max_ns / 1000.0,
+            c->calls
+        );
+    }
+    if(self->dropped)
+        fprintf(stream, "%zu trace events dropped\n", self->dropped);
+    perf_histogram_dump(&self->latency, stream);
+}
+
+/**
+ * @brief Same as perf_counters_dump but using the figures accumulated
+ * since startup instead of the last window.
+ */
+void perf_counters_dump_totals(FILE *stream)
+{
+    PerfCounters *self = &_perf_counters;
+
+    fprintf(stream, "%-28s %-20s %12s %12s %10s\n",
+        "scope", "parent", "total(ms)", "frame(us)", "calls"
+    );
+    for(int i = 0; i < self->ncounters; i++){
+        PerfCounter *c = &self->counters[i];
+        fprintf(stream, "%*s%-*s %-20s %12.3f %12.3f %10" PRIu64 "\n",
+            c->depth, "", 28 - c->depth, c->name,
+            c->parent ? c->parent : "-",
+            c->total_ns / 1000000.0,
+            self->total_frames ? c->total_ns / 1000.0 / self->total_frames : 0.0,
+            c->total_calls
+        );
+    }
+    perf_histogram_dump(&self->latency_total, stream);
+}
+
+static PerfCounter *perf_counters_lookup(PerfCounters *self, const char *name,
+                                         const char *parent, uint8_t depth)
+{
+    for(int i = 0; i < self->ncounters; i++){
+        if(self->counters[i].name == name && self->counters[i].parent == parent)
+            return &self->counters[i];
+    }
+    if(self->ncounters == PERF_MAX_COUNTERS){
+        printf("%s: PERF_MAX_COUNTERS(%d) reached, please increment\n",
+            __FUNCTION__, PERF_MAX_COUNTERS
+        );
+        return NULL;
+    }
+    self->counters[self->ncounters] = (PerfCounter){
+        .name = name,
+        .parent = parent,
+        .depth = depth
+    };
+    return &self->counters[self->ncounters++];
+}
+
+static void perf_counters_publish(PerfCounters *self, uint64_t now)
+{
+    for(int i = 0; i < self->ncounters; i++){
+        PerfCounter *c = &self->counters[i];
+
+        c->avg_ns = c->acc_ns / self->window_frames;
+        c->max_ns = c->acc_max_ns;
+        c->calls = (c->acc_count + self->window_frames - 1) / self->window_frames;
+
+        c->acc_ns = 0;
+        c->acc_max_ns = 0;
+        c->acc_count = 0;
+    }
+    self->latency = self->latency_acc;
+    self->latency_acc = (PerfHistogram){0};
+
+    self->window_frames = 0;
+    self->window_start_ns = now;
+    self->generation++;
+}
+
+static void perf_counters_write_trace(PerfCounters *self)
+{
+    for(int i = 0; i < self->nevents; i++){
+        PerfEvent *e = &self->events[i];
+
+        fprintf(self->trace,
+            "%s{\"name\":\"%s\",\"cat\":\"sofis\",\"ph\":\"X\","
+            "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+            self->trace_first ? "" : ",\n",
+            e->name,
+            (e->start_ns - self->origin_ns) / 1000.0,
+            e->duration_ns / 1000.0
+        );
+        self->trace_first = false;
+    }
+}
+
+static void perf_histogram_add(PerfHistogram *self, uint64_t ns)
+{
+    uint64_t idx;
+
+    idx = ns / (PERF_LATENCY_STEP_MS * 1000000ULL);
+    if(idx >= PERF_LATENCY_BUCKETS)
+        idx = PERF_LATENCY_BUCKETS - 1;
+    self->buckets[idx]++;
+    self->count++;
+    self->sum_ns += ns;
+    if(ns > self->max_ns)
+        self->max_ns = ns;
+}
+
+static void perf_histogram_dump(PerfHistogram *self, FILE *stream)
+{
+    if(!self->count)
+        return;
+
+    fprintf(stream, "latency(ms): avg %.1f p50 %.0f p90 %.0f p99 %.0f max %.1f (%" PRIu64 " samples)\n",
+        self->sum_ns / 1000000.0 / self->count,
+        perf_histogram_percentile(self, 50),
+        perf_histogram_percentile(self, 90),
+        perf_histogram_percentile(self, 99),
+        self->max_ns / 1000000.0,
+        self->count
+    );
+    for(int i = 0; i < PERF_LATENCY_BUCKETS; i++){
+        if(!self->buckets[i])
+            continue;
+        fprintf(stream, "  %s%3d ms: %u\n",
+            i == PERF_LATENCY_BUCKETS - 1 ? ">=" : "< ",
+            i == PERF_LATENCY_BUCKETS - 1 ? i * PERF_LATENCY_STEP_MS : (i + 1) * PERF_LATENCY_STEP_MS,
+            self->buckets[i]
+        );
+    }
+}
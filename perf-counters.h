@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef ENABLE_PERF_COUNTERS
+#define ENABLE_PERF_COUNTERS 0
+#endif
+
+#define PERF_MAX_DEPTH 16
+#define PERF_MAX_EVENTS 512 /*per frame*/
+#define PERF_MAX_COUNTERS 96
+#define PERF_WINDOW_MS 1000 /*stats are averaged over that period*/
+#define PERF_LATENCY_BUCKETS 64
+#define PERF_LATENCY_STEP_MS 2 /*the last bucket gets everything above*/
+
+/* A timed scope. Samples are keyed by (name, parent name) pointers, not
+ * string contents: always pass string literals or static storage.
+ */
+typedef struct{
+    const char *name;
+    const char *parent;
+    uint8_t depth;
+
+    /*Window being accumulated*/
+    uint64_t acc_ns;
+    uint64_t acc_max_ns;
+    uint32_t acc_count;
+
+    /*Last complete window*/
+    uint64_t avg_ns;    /*per frame, not per call*/
+    uint64_t max_ns;    /*worst single call*/
+    uint32_t calls;     /*per frame*/
+
+    /*Since startup, never reset*/
+    uint64_t total_ns;
+    uint64_t total_calls;
+}PerfCounter;
+
+typedef struct{
+    const char *name;
+    uint8_t depth;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    PerfCounter *counter; /*Aggregate this event went to, can be NULL*/
+}PerfEvent;
+
+typedef struct{
+    uint32_t buckets[PERF_LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+}PerfHistogram;
+
+typedef struct{
+    struct{
+        const char *name;
+        uint64_t start_ns;
+    }stack[PERF_MAX_DEPTH];
+    uint8_t depth;
+
+    PerfEvent events[PERF_MAX_EVENTS];
+    size_t nevents;
+    size_t dropped;
+
+    PerfCounter counters[PERF_MAX_COUNTERS];
+    size_t ncounters;
+
+    uint64_t origin_ns;
+    uint64_t window_start_ns;
+    uint32_t window_frames;
+    uint64_t total_frames;
+    uint32_t generation; /*bumped each time window stats are published*/
+
+    /*Sample acquisition to display, see perf_counters_record_latency*/
+    PerfHistogram latency_acc;
+    PerfHistogram latency;
+    PerfHistogram latency_total;
+
+    FILE *trace;
+    bool trace_first;
+}PerfCounters;
+
+#if ENABLE_PERF_COUNTERS
+#define PERF_BEGIN(name) perf_counters_begin((name))
+#define PERF_END() perf_counters_end()
+#define PERF_FRAME_BEGIN() perf_counters_frame_begin()
+#define PERF_FRAME_END() perf_counters_frame_end()
+#define PERF_LATENCY(ns) perf_counters_record_latency((ns))
+#else
+#define PERF_BEGIN(name) do{}while(0)
+#define PERF_END() do{}while(0)
+#define PERF_FRAME_BEGIN() do{}while(0)
+#define PERF_FRAME_END() do{}while(0)
+#define PERF_LATENCY(ns) do{}while(0)
+#endif
+
+PerfCounters *perf_counters_get_instance(void);
+
+void perf_counters_begin(const char *name);
+void perf_counters_end(void);
+
+void perf_counters_frame_begin(void);
+void perf_counters_frame_end(void);
+
+bool perf_counters_start_trace(const char *filename);
+void perf_counters_stop_trace(void);
+static inline bool perf_counters_tracing(void)
+{
+    return perf_counters_get_instance()->trace != NULL;
+}
+
+void perf_counters_record_latency(uint64_t ns);
+double perf_histogram_percentile(PerfHistogram *self, double pct);
+
+size_t perf_counters_sorted(PerfCounter **dst, size_t ndst, uint8_t max_depth);
+void perf_counters_dump(FILE *stream);
+void perf_counters_dump_totals(FILE *stream);
+#endif /* PERF_COUNTERS_H */
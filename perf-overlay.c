@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base-gauge.h"
+#include "perf-counters.h"
+#include "perf-overlay.h"
+#include "resource-manager.h"
+#include "sdl-colors.h"
+#include "text-gauge.h"
+
+#define LINE_HEIGHT 13
+
+static void perf_overlay_render(PerfOverlay *self, Uint32 dt, RenderContext *ctx);
+static BaseGaugeOps perf_overlay_ops = {
+   .name = "PerfOverlay",
+   .render = (RenderFunc)perf_overlay_render,
+   .update_state = (StateUpdateFunc)NULL,
+   .dispose = (DisposeFunc)NULL
+};
+
+PerfOverlay *perf_overlay_new(void)
+{
+    PerfOverlay *self;
+
+    self = calloc(1, sizeof(PerfOverlay));
+    if(self){
+        if(!perf_overlay_init(self)){
+            return base_gauge_free(BASE_GAUGE(self));
+        }
+    }
+    return self;
+}
+
+PerfOverlay *perf_overlay_init(PerfOverlay *self)
+{
+    PCF_StaticFont *font;
+
+    base_gauge_init(BASE_GAUGE(self),
+        &perf_overlay_ops,
+        PERF_OVERLAY_COLS * 6 + 4,
+        PERF_OVERLAY_LINES * LINE_HEIGHT + 4
+    );
+
+    font = resource_manager_get_static_font(TERMINUS_12,
+        &SDL_WHITE,
+        3, PCF_ALPHA, PCF_DIGITS, " ._<>()%:/"
+    );
+    for(int i = 0; i < PERF_OVERLAY_LINES; i++){
+        self->lines[i] = text_gauge_new(NULL, false, PERF_OVERLAY_COLS * 6, LINE_HEIGHT);
+        if(!self->lines[i])
+            return NULL;
+        text_gauge_set_static_font(self->lines[i], font);
+        self->lines[i]->alignment = HALIGN_LEFT | VALIGN_MIDDLE;
+        base_gauge_add_child(BASE_GAUGE(self), BASE_GAUGE(self->lines[i]),
+            2, 2 + i * LINE_HEIGHT
+        );
+    }
+    text_gauge_set_value(self->lines[0], "Waiting for perf counters...");
+    /*Will pick up the first window as soon as it is published*/
+    self->generation = perf_counters_get_instance()->generation;
+
+    return self;
+}
+
+static void perf_overlay_refresh(PerfOverlay *self)
+{
+    PerfCounter *sorted[PERF_OVERLAY_LINES-2];
+    PerfCounters *counters;
+    size_t n;
+
+    counters = perf_counters_get_instance();
+    self->generation = counters->generation;
+
+    text_gauge_set_value_formatn(self->lines[0], PERF_OVERLAY_COLS,
+        "%-24s %7s %5s%s", "SCOPE<PARENT", "AVG MS", "CALLS",
+        perf_counters_tracing() ? " REC" : ""
+    );
+    n = perf_counters_sorted(sorted, PERF_OVERLAY_LINES-2, PERF_MAX_DEPTH);
+    for(int i = 0; i < PERF_OVERLAY_LINES-2; i++){
+        char scope[25];
+
+        if(i >= n){
+            text_gauge_set_value(self->lines[i+1], "");
+            continue;
+        }
+        snprintf(scope, sizeof(scope), "%s%s%s",
+            sorted[i]->name,
+            sorted[i]->parent ? "<" : "",
+            sorted[i]->parent ? sorted[i]->parent : ""
+        );
+        text_gauge_set_value_formatn(self->lines[i+1], PERF_OVERLAY_COLS,
+            "%-24s %7.2f %5u",
+            scope, sorted[i]->avg_ns / 1000000.0, sorted[i]->calls
+        );
+    }
+
+    /*Last line: sample acquisition to display*/
+    if(counters->latency.count){
+        text_gauge_set_value_formatn(self->lines[PERF_OVERLAY_LINES-1], PERF_OVERLAY_COLS,
+            "LATENCY MS P50 %.0f P99 %.0f MAX %.1f",
+            perf_histogram_percentile(&counters->latency, 50),
+            perf_histogram_percentile(&counters->latency, 99),
+            counters->latency.max_ns / 1000000.0
+        );
+    }else{
+        text_gauge_set_value(self->lines[PERF_OVERLAY_LINES-1], "LATENCY MS NO SAMPLES");
+    }
+}
+
+static void perf_overlay_render(PerfOverlay *self, Uint32 dt, RenderContext *ctx)
+{
+    /* Done here rather than in update_state as nothing sets the gauge
+     * dirty when new stats are available. Children are rendered after us
+     * and will pick the changes in the same frame*/
+    if(self->generation != perf_counters_get_instance()->generation)
+        perf_overlay_refresh(self);
+
+    base_gauge_fill(BASE_GAUGE(self), ctx, NULL, &(SDL_Color){0, 0, 0, 180}, false);
+    base_gauge_draw_outline(BASE_GAUGE(self), ctx, &SDL_WHITE, NULL);
+}
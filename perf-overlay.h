@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef PERF_OVERLAY_H
+#define PERF_OVERLAY_H
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "base-gauge.h"
+#include "text-gauge.h"
+
+#define PERF_OVERLAY_LINES 16
+#define PERF_OVERLAY_COLS 40
+
+/* Shows the perf counters of the previous window on top of
+ * everything else. Mostly useless when ENABLE_PERF_COUNTERS=0
+ * as nothing will ever be collected.
+ */
+typedef struct{
+    BaseGauge super;
+
+    TextGauge *lines[PERF_OVERLAY_LINES];
+    uint32_t generation; /*Last PerfCounters generation displayed*/
+    bool visible;
+}PerfOverlay;
+
+PerfOverlay *perf_overlay_new(void);
+PerfOverlay *perf_overlay_init(PerfOverlay *self);
+
+#endif /* PERF_OVERLAY_H */
@@ -21,6 +21,10 @@
 #define FONT_DIR SFS_HOME"/resources/fonts"
 #endif
 
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR SFS_HOME"/resources/golden"
+#endif
+
 #ifndef MAPS_HOME
 #define MAPS_HOME SFS_HOME"/resources/maps"
 #endif
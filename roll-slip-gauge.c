@@ -21,6 +21,7 @@ static void roll_slip_gauge_render(RollSlipGauge *self, Uint32 dt, RenderContext
 static void roll_slip_gauge_update_state(RollSlipGauge *self, Uint32 dt);
 static RollSlipGauge *roll_slip_gauge_dispose(RollSlipGauge *self);
 static BaseGaugeOps roll_slip_gauge_ops = {
+   .name = "RollSlipGauge",
    .render = (RenderFunc)roll_slip_gauge_render,
    .update_state = (StateUpdateFunc)roll_slip_gauge_update_state,
    .dispose = (DisposeFunc)roll_slip_gauge_dispose
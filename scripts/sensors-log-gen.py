@@ -0,0 +1,86 @@
+#! /usr/bin/python3
+# SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+#
+# This file is part of SoFIS - an open source EFIS
+#
+# SPDX-License-Identifier: GPL-2.0-only
+
+# Writes a synthetic sensor log (see sensor-log.h) to be replayed with
+# ./sofis --sensors-replay file: a climbing turn flown at 50m/s, 100Hz
+# IMU, 1Hz noisy GPS. Truth is written as comments for comparison.
+#
+#   scripts/sensors-log-gen.py flight.slog
+#   scripts/sensors-log-gen.py --no-rates flight.slog   BNO080-like IMU
+
+import argparse
+import math
+import random
+
+EARTH_RADIUS = 6371000.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("output")
+    parser.add_argument("--duration", type=float, default=120, help="seconds")
+    parser.add_argument("--imu-rate", type=float, default=100, help="Hz")
+    parser.add_argument("--gps-rate", type=float, default=1, help="Hz")
+    parser.add_argument("--gps-noise", type=float, default=3, help="meters, 1 sigma")
+    parser.add_argument("--no-rates", action="store_true",
+                        help="absolute attitude only, like the BNO080 driver")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    speed = 50.0
+    lat, lon, alt = 45.215470, 5.844828, 718.0
+    heading = 0.0
+    dt = 1.0 / args.imu_rate
+    gps_every = int(round(args.imu_rate / args.gps_rate))
+    nan = float("nan")
+
+    with open(args.output, "w") as out:
+        for i in range(int(args.duration * args.imu_rate)):
+            t = i * dt
+            # Turn for 30s, straight for 30s; climb/descent as a sine
+            turning = (t // 30) % 2 == 0
+            roll = 25.0 if turning else 0.0
+            yaw_rate = math.degrees(9.81 * math.tan(math.radians(roll)) / speed)
+            vs = 4.0 * math.sin(t / 15.0)
+            accel_z = 4.0 / 15.0 * math.cos(t / 15.0)
+            pitch = math.degrees(math.asin(vs / speed))
+
+            heading = (heading + yaw_rate * dt) % 360.0
+            lat += math.degrees(speed * dt * math.cos(math.radians(heading)) / EARTH_RADIUS)
+            lon += math.degrees(speed * dt * math.sin(math.radians(heading))
+                                / (EARTH_RADIUS * math.cos(math.radians(lat))))
+            alt += vs * dt
+
+            ns = int(t * 1e9)
+            if args.no_rates:
+                rates = (nan, nan, nan)
+                az = nan
+            else:
+                rates = (random.gauss(0, 0.5), random.gauss(0, 0.5),
+                         yaw_rate + random.gauss(0, 0.5))
+                az = accel_z + random.gauss(0, 0.2)
+            out.write("I,%d,%g,%g,%g,%g,%g,%g,%g\n" % (
+                ns,
+                roll + random.gauss(0, 1.0),
+                pitch + random.gauss(0, 1.0),
+                (heading + random.gauss(0, 2.0)) % 360.0,
+                rates[0], rates[1], rates[2], az))
+
+            if i % gps_every == 0:
+                n = args.gps_noise
+                out.write("# truth,%d,%.8f,%.8f,%.2f,%.3f,%.2f\n" % (ns, lat, lon, alt, vs, heading))
+                out.write("G,%d,%.8f,%.8f,%.2f,nan,nan\n" % (
+                    ns,
+                    lat + math.degrees(random.gauss(0, n) / EARTH_RADIUS),
+                    lon + math.degrees(random.gauss(0, n)
+                                       / (EARTH_RADIUS * math.cos(math.radians(lat)))),
+                    alt + random.gauss(0, n * 1.5)))
+
+
+if __name__ == "__main__":
+    main()
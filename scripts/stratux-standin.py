@@ -0,0 +1,131 @@
+#! /usr/bin/python3
+# SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+#
+# This file is part of SoFIS - an open source EFIS
+#
+# SPDX-License-Identifier: GPL-2.0-only
+
+# Local stand-in for a Stratux box: pushes situation updates on the
+# /situation WebSocket and answers /getSituation, using a recorded response
+# as a template and sweeping the attitude/position values.
+#
+#   scripts/stratux-standin.py --port 8080 &
+#   ./sofis --stratux 127.0.0.1:8080
+
+import argparse
+import base64
+import hashlib
+import json
+import math
+import socket
+import struct
+import threading
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+
+def situation(template, t):
+    s = dict(template)
+    s["GPSLatitude"] = template["GPSLatitude"] + t * 0.0005
+    s["GPSLongitude"] = template["GPSLongitude"] + t * 0.0005
+    s["GPSHeightAboveEllipsoid"] = 2000 + 1500 * math.sin(t / 7.0)
+    s["GPSVerticalSpeed"] = 15 * math.cos(t / 7.0)
+    s["AHRSRoll"] = 45 * math.sin(t / 3.0)
+    s["AHRSPitch"] = 15 * math.sin(t / 5.0)
+    s["AHRSGyroHeading"] = (t * 6.0) % 360.0
+    return json.dumps(s, separators=(',', ':')).encode()
+
+
+def ws_frame(payload):
+    header = bytes([0x81])  # FIN, text
+    n = len(payload)
+    if n < 126:
+        header += bytes([n])
+    elif n < 65536:
+        header += bytes([126]) + struct.pack(">H", n)
+    else:
+        header += bytes([127]) + struct.pack(">Q", n)
+    return header + payload
+
+
+def read_request(conn, pending):
+    while b"\r\n\r\n" not in pending:
+        chunk = conn.recv(4096)
+        if not chunk:
+            return None, b""
+        pending += chunk
+    head, rest = pending.split(b"\r\n\r\n", 1)
+    lines = head.decode(errors="replace").split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        if ":" in line:
+            k, v = line.split(":", 1)
+            headers[k.strip().lower()] = v.strip()
+    return (lines[0].split(" ")[1], headers), rest
+
+
+def serve(conn, template, rate, start):
+    pending = b""
+    while True:
+        request, pending = read_request(conn, pending)
+        if request is None:
+            return
+        path, headers = request
+        if path != "/getSituation":
+            break
+        # Keep-alive, like the real thing
+        body = situation(template, time.time() - start)
+        conn.sendall(b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                     b"Content-Length: %d\r\n\r\n" % len(body) + body)
+
+    if path != "/situation" or "sec-websocket-key" not in headers:
+        conn.sendall(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")
+        return
+
+    accept = base64.b64encode(hashlib.sha1(
+        (headers["sec-websocket-key"] + WS_GUID).encode()).digest()).decode()
+    conn.sendall(("HTTP/1.1 101 Switching Protocols\r\n"
+                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Accept: %s\r\n\r\n" % accept).encode())
+    print("streaming situation")
+    while True:
+        conn.sendall(ws_frame(situation(template, time.time() - start)))
+        time.sleep(1.0 / rate)
+
+
+def handle(conn, template, rate, start):
+    try:
+        serve(conn, template, rate, start)
+    except (BrokenPipeError, ConnectionResetError):
+        print("client gone")
+    finally:
+        conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stratux stand-in")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--rate", type=float, default=10.0,
+                        help="situation updates per second")
+    parser.add_argument("--template", default="resources/stratux/situation.json")
+    args = parser.parse_args()
+
+    with open(args.template) as f:
+        template = json.load(f)
+
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(("", args.port))
+    srv.listen(4)
+    print("Listening on port %d, %.1f updates/s" % (args.port, args.rate))
+    start = time.time()
+    while True:
+        conn, addr = srv.accept()
+        print("connection from %s:%d" % addr[:2])
+        threading.Thread(target=handle, args=(conn, template, args.rate, start),
+                         daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+#! /usr/bin/python3
+# SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+#
+# This file is part of SoFIS - an open source EFIS
+#
+# SPDX-License-Identifier: GPL-2.0-only
+
+# Feeds SoFIS (--xplane) with X-Plane DATA packets, without X-Plane:
+#
+#   scripts/xplane-replay.py                      synthetic flight
+#   scripts/xplane-replay.py --record flight.xpr  capture what X-Plane sends
+#   scripts/xplane-replay.py --replay flight.xpr  send a capture back
+#
+# Captures are a sequence of (float64 seconds, uint32 length, datagram),
+# little-endian.
+
+import argparse
+import math
+import socket
+import struct
+import time
+
+RECORD_HEADER = struct.Struct("<dI")
+
+
+def data_packet(rows):
+    packet = b"DATA*"
+    for row_id, values in rows.items():
+        values = list(values) + [-999.0] * (8 - len(values))
+        packet += struct.pack("<i8f", row_id, *values)
+    return packet
+
+
+def synthetic(t):
+    return data_packet({
+        3: (95 + 10 * math.sin(t / 9.0), 0, 100, 98),            # kias, _, ktas, ktgs
+        4: (0, 0, 500 * math.sin(t / 7.0)),                      # vvi fpm
+        17: (5 * math.sin(t / 5.0), 30 * math.sin(t / 3.0), 0,   # pitch, roll,
+             (t * 3.0) % 360.0),                                 # _, heading mag
+        18: (0, 0, 0, 0, 0, 0, 0, 2 * math.sin(t / 4.0)),        # slip
+        20: (45.3628 + t * 1e-4, 5.3292 + t * 1e-4,              # lat, lon,
+             3000 + 500 * math.sin(t / 11.0)),                   # alt ft
+        37: (2400 + 100 * math.sin(t / 6.0),),                   # rpm
+        43: (24 + math.sin(t / 6.0),),                           # manifold inHg
+        45: (8.5,),                                              # fuel flow gph
+        47: (1350 + 50 * math.sin(t / 8.0),),                    # egt
+        48: (380,),                                              # cht
+        49: (55,),                                               # oil press
+        50: (190,),                                              # oil temp
+        51: (4.5,),                                              # fuel press
+        54: (13.8,),                                             # volts
+        62: (10 - t / 600.0, 10 - t / 600.0, 0, 0),              # fuel qty
+        99: (0,),                                                # unsupported
+    })
+
+
+def record(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    print("Recording datagrams sent to port %d into %s, ^C to stop" % (args.port, args.record))
+    start = time.monotonic()
+    count = 0
+    with open(args.record, "wb") as f:
+        try:
+            while True:
+                packet = sock.recv(65536)
+                f.write(RECORD_HEADER.pack(time.monotonic() - start, len(packet)))
+                f.write(packet)
+                count += 1
+        except KeyboardInterrupt:
+            pass
+    print("%d datagrams recorded" % count)
+
+
+def replay(args, sock, dest):
+    with open(args.replay, "rb") as f:
+        data = f.read()
+    while True:
+        start = time.monotonic()
+        offset = 0
+        count = 0
+        while offset + RECORD_HEADER.size <= len(data):
+            when, length = RECORD_HEADER.unpack_from(data, offset)
+            offset += RECORD_HEADER.size
+            packet = data[offset:offset + length]
+            offset += length
+            delay = when / args.speed - (time.monotonic() - start)
+            if delay > 0:
+                time.sleep(delay)
+            sock.sendto(packet, dest)
+            count += 1
+        print("%d datagrams replayed" % count)
+        if not args.loop:
+            break
+
+
+def main():
+    parser = argparse.ArgumentParser(description="X-Plane DATA packets replay")
+    parser.add_argument("--host", default="127.0.0.1", help="SoFIS address")
+    parser.add_argument("--port", type=int, default=49000, help="SoFIS port")
+    parser.add_argument("--rate", type=float, default=20.0,
+                        help="synthetic packets per second")
+    parser.add_argument("--burst", type=int, default=1,
+                        help="synthetic packets sent back to back, to check that SoFIS keeps up")
+    parser.add_argument("--record", metavar="FILE", help="capture packets sent to --port")
+    parser.add_argument("--replay", metavar="FILE", help="send a capture")
+    parser.add_argument("--speed", type=float, default=1.0, help="replay speed factor")
+    parser.add_argument("--loop", action="store_true", help="replay forever")
+    args = parser.parse_args()
+
+    if args.record:
+        record(args)
+        return
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    dest = (args.host, args.port)
+    if args.replay:
+        replay(args, sock, dest)
+        return
+
+    print("Sending synthetic DATA packets to %s:%d, %.1f/s" % (dest + (args.rate,)))
+    start = time.monotonic()
+    try:
+        while True:
+            t = time.monotonic() - start
+            for _ in range(args.burst):
+                sock.sendto(synthetic(t), dest)
+            time.sleep(1.0 / args.rate)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sensor-log.h"
+
+SensorLog *sensor_log_new(const char *filename, bool writing)
+{
+    SensorLog *self;
+
+    self = calloc(1, sizeof(SensorLog));
+    if(!self)
+        return NULL;
+
+    self->fp = fopen(filename, writing ? "w" : "r");
+    if(!self->fp){
+        printf("%s: couldn't open %s: %s\n", __FUNCTION__, filename, strerror(errno));
+        free(self);
+        return NULL;
+    }
+    self->writing = writing;
+    if(writing)
+        fprintf(self->fp,
+            "# I,t_ns,roll,pitch,heading,gyro_x,gyro_y,gyro_z,accel_z\n"
+            "# G,t_ns,latitude,longitude,altitude_m,speed_ms,track\n"
+        );
+    return self;
+}
+
+void sensor_log_free(SensorLog *self)
+{
+    if(self->fp)
+        fclose(self->fp);
+    free(self);
+}
+
+/**
+ * @brief Reads the next entry, skipping comments and malformed lines.
+ *
+ * @return true if @p entry has been filled, false at the end of the log
+ */
+bool sensor_log_read(SensorLog *self, SensorLogEntry *entry)
+{
+    char line[256];
+    unsigned long long t;
+    int n;
+
+    while(fgets(line, sizeof(line), self->fp)){
+        self->line++;
+        if(line[0] == 'I'){
+            ImuSample *s = &entry->imu;
+
+            n = sscanf(line, "I,%llu,%f,%f,%f,%f,%f,%f,%f", &t,
+                &s->roll, &s->pitch, &s->heading,
+                &s->gyro[0], &s->gyro[1], &s->gyro[2],
+                &s->accel_z
+            );
+            if(n == 8){
+                entry->kind = SENSOR_LOG_IMU;
+                s->t = t;
+                return true;
+            }
+        }else if(line[0] == 'G'){
+            GpsFix *f = &entry->gps;
+
+            n = sscanf(line, "G,%llu,%lf,%lf,%f,%f,%f", &t,
+                &f->latitude, &f->longitude, &f->altitude,
+                &f->speed, &f->track
+            );
+            if(n == 6){
+                entry->kind = SENSOR_LOG_GPS;
+                f->t = t;
+                return true;
+            }
+        }else if(line[0] == '#' || line[0] == '\n'){
+            continue;
+        }
+        printf("%s: line %zu is malformed, skipping\n", __FUNCTION__, self->line);
+    }
+    return false;
+}
+
+bool sensor_log_write_imu(SensorLog *self, const ImuSample *s)
+{
+    return fprintf(self->fp, "I,%llu,%g,%g,%g,%g,%g,%g,%g\n",
+        (unsigned long long)s->t,
+        s->roll, s->pitch, s->heading,
+        s->gyro[0], s->gyro[1], s->gyro[2],
+        s->accel_z
+    ) > 0;
+}
+
+bool sensor_log_write_gps(SensorLog *self, const GpsFix *f)
+{
+    return fprintf(self->fp, "G,%llu,%.8f,%.8f,%g,%g,%g\n",
+        (unsigned long long)f->t,
+        f->latitude, f->longitude, f->altitude,
+        f->speed, f->track
+    ) > 0;
+}
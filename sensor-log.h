@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "ahrs-filter.h"
+
+typedef enum{
+    SENSOR_LOG_IMU,
+    SENSOR_LOG_GPS
+}SensorLogKind;
+
+typedef struct{
+    SensorLogKind kind;
+    union{
+        ImuSample imu;
+        GpsFix gps;
+    };
+}SensorLogEntry;
+
+/* Text log of raw sensor readings, one per line, for replay:
+ * I,t_ns,roll,pitch,heading,gyro_x,gyro_y,gyro_z,accel_z
+ * G,t_ns,latitude,longitude,altitude_m,speed_ms,track
+ * Units are the ones of ImuSample/GpsFix, missing values are "nan".
+ * Lines starting with # are comments.
+ */
+typedef struct{
+    FILE *fp;
+    bool writing;
+    size_t line;
+}SensorLog;
+
+SensorLog *sensor_log_new(const char *filename, bool writing);
+void sensor_log_free(SensorLog *self);
+
+bool sensor_log_read(SensorLog *self, SensorLogEntry *entry);
+bool sensor_log_write_imu(SensorLog *self, const ImuSample *sample);
+bool sensor_log_write_gps(SensorLog *self, const GpsFix *fix);
+
+static inline uint64_t sensor_log_entry_time(SensorLogEntry *entry)
+{
+    return (entry->kind == SENSOR_LOG_IMU) ? entry->imu.t : entry->gps.t;
+}
+#endif /* SENSOR_LOG_H */
@@ -8,7 +8,9 @@
 #include <gps.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
+#include "misc.h"
 #include "sensors-data-source.h"
 #include "sensors/gps-sensor.h"
 
@@ -20,6 +22,9 @@
 #define ENABLE_MOCK_GPS 0
 #endif
 
+#define M2FT 3.281
+#define MS2KTS 1.943844
+
 static bool sensors_data_source_frame(SensorsDataSource *self, uint32_t dt);
 static SensorsDataSource *sensors_data_source_dispose(SensorsDataSource *self);
 static DataSourceOps sensors_data_source_ops = {
@@ -27,13 +32,20 @@ static DataSourceOps sensors_data_source_ops = {
     .dispose = (DataSourceDisposeFunc)sensors_data_source_dispose
 };
 
-SensorsDataSource *sensors_data_source_new(void)
+/**
+ * @brief Creates a DataSource fusing the onboard IMU and GPS.
+ *
+ * @param replay When not NULL, raw readings are read from this
+ * sensor log (see sensor-log.h) instead of the sensors, at the pace
+ * they have been recorded.
+ */
+SensorsDataSource *sensors_data_source_new(const char *replay)
 {
     SensorsDataSource *self;
 
     self = calloc(1, sizeof(SensorsDataSource));
     if(self){
-        if(!sensors_data_source_init(self)){
+        if(!sensors_data_source_init(self, replay)){
             free(self);
             return NULL;
         }
@@ -41,89 +53,210 @@ SensorsDataSource *sensors_data_source_new(void)
     return self;
 }
 
-SensorsDataSource *sensors_data_source_init(SensorsDataSource *self)
+SensorsDataSource *sensors_data_source_init(SensorsDataSource *self, const char *replay)
 {
     if(!data_source_init(DATA_SOURCE(self), &sensors_data_source_ops))
         return NULL;
 
+    ahrs_filter_init(&self->ahrs);
+
+    if(replay){
+        self->replay = sensor_log_new(replay, false);
+        if(!self->replay)
+            return NULL;
+        self->has_pending = sensor_log_read(self->replay, &self->pending);
+        if(!self->has_pending)
+            printf("%s: %s holds no sensor readings\n", __FUNCTION__, replay);
+        return self;
+    }
+
+    /*Callers decide whether to go on without the sensors*/
     if(!bno080_init(&self->imu, 0x4b, BNO080_DEV)){
-        printf("Couldn't initialize BNO0808 device, bailing out\n");
-        exit(EXIT_FAILURE);
+        printf("Couldn't initialize BNO0808 device\n");
+        return NULL;
     }
     bno080_enable_feature(&self->imu, ROTATION_VECTOR);
 
 
     if(!gps_sensor_init(&self->gps, "localhost", DEFAULT_GPSD_PORT)){
-        printf("Couldn't initialize GPS, bailing out\n");
-        exit(EXIT_FAILURE);
+        printf("Couldn't initialize GPS\n");
+        bno080_dispose(&self->imu);
+        return NULL;
     }
 
 #if !ENABLE_MOCK_GPS
     gps_sensor_start(&self->gps);
 #else
-    data_source_set_location(
-        DATA_SOURCE(self), &(LocationData){
-            .super.latitude = 45.215470,
-            .super.longitude = 5.844828,
-            .altitude = 718.267245
-        }
-    );
-
-    data_source_set_attitude(
-        DATA_SOURCE(self), &(AttitudeData){
-            .roll = 0,
-            .pitch = 0,
-            .heading = 43.698940
-        }
-    );
+    ahrs_filter_gps(&self->ahrs, &(GpsFix){
+        .t = monotonic_ns(),
+        .latitude = 45.215470,
+        .longitude = 5.844828,
+        .altitude = 718.267245 / M2FT,
+        .speed = NAN,
+        .track = NAN
+    });
 #endif
     return self;
 }
 
+/**
+ * @brief Also writes raw sensor readings to @p filename, to be replayed
+ * later on with sensors_data_source_new(filename).
+ */
+bool sensors_data_source_record(SensorsDataSource *self, const char *filename)
+{
+    if(self->record)
+        sensor_log_free(self->record);
+    self->record = sensor_log_new(filename, true);
+    return self->record != NULL;
+}
+
 static SensorsDataSource *sensors_data_source_dispose(SensorsDataSource *self)
 {
-    bno080_dispose(&self->imu);
+    if(self->replay){
+        sensor_log_free(self->replay);
+    }else{
+        /*Stops the gpsd worker, that writes into self*/
+        gps_sensor_dispose(&self->gps);
+        bno080_dispose(&self->imu);
+    }
+    if(self->record)
+        sensor_log_free(self->record);
     return self;
 }
 
+static void sensors_data_source_imu(SensorsDataSource *self, ImuSample *sample)
+{
+    ahrs_filter_imu(&self->ahrs, sample);
+    if(self->record)
+        sensor_log_write_imu(self->record, sample);
+}
+
+static void sensors_data_source_gps(SensorsDataSource *self, GpsFix *fix)
+{
+    ahrs_filter_gps(&self->ahrs, fix);
+    if(self->record)
+        sensor_log_write_gps(self->record, fix);
+}
+
+static bool sensors_data_source_acquire(SensorsDataSource *self)
+{
+    double roll, pitch, heading;
+#if !ENABLE_MOCK_GPS
+    GpsSensorFix fix;
+    bool has_gps;
+#endif
+    uint64_t now;
+
+    now = monotonic_ns();
+    bno080_hpr(&self->imu, &heading, &pitch, &roll);
+    /* The BNO080 fuses its gyro, accelerometer and magnetometer on
+     * its own and only gives the resulting absolute attitude*/
+    sensors_data_source_imu(self, &(ImuSample){
+        .t = now,
+        .roll = roll,
+        .pitch = pitch,
+        .heading = heading,
+        .gyro = {NAN, NAN, NAN},
+        .accel_z = NAN
+    });
+
+#if !ENABLE_MOCK_GPS
+    has_gps = gps_sensor_get_fix(&self->gps, &fix);
+    if(fix.t == self->last_fix)
+        return true;
+    self->last_fix = fix.t;
+    if(!has_gps){
+        /*The filter keeps dead reckoning from the last fix*/
+        printf("GPS fix lost\n");
+        return true;
+    }
+    sensors_data_source_gps(self, &(GpsFix){
+        .t = fix.t,
+        .latitude = fix.latitude,
+        .longitude = fix.longitude,
+        .altitude = fix.altitude,
+        .speed = fix.speed,
+        .track = fix.track
+    });
+#endif
+    return true;
+}
+
+/**
+ * @brief Feeds the filter with the log entries whose time has come.
+ *
+ * @return true if at least one entry has been consumed
+ */
+static bool sensors_data_source_replay(SensorsDataSource *self)
+{
+    uint64_t now;
+    bool rv;
+
+    if(!self->has_pending)
+        return false;
+
+    now = monotonic_ns();
+    if(!self->replay_start){
+        self->replay_start = now;
+        self->log_start = sensor_log_entry_time(&self->pending);
+    }
+
+    rv = false;
+    while(self->has_pending
+          && sensor_log_entry_time(&self->pending) - self->log_start <= now - self->replay_start)
+    {
+        if(self->pending.kind == SENSOR_LOG_IMU)
+            ahrs_filter_imu(&self->ahrs, &self->pending.imu);
+        else
+            ahrs_filter_gps(&self->ahrs, &self->pending.gps);
+        rv = true;
+        self->has_pending = sensor_log_read(self->replay, &self->pending);
+    }
+    if(!self->has_pending)
+        printf("%s: end of sensor log\n", __FUNCTION__);
+    return rv;
+}
+
 static bool sensors_data_source_frame(SensorsDataSource *self, uint32_t dt)
 {
-    double roll, pitch, yaw;
-    double heading;
-    double lat, lon, alt;
+    AhrsFilter *ahrs = &self->ahrs;
     bool rv;
 
-    if(dt != 0 && dt < (1000/25)) //One update per 1/25 second
+    /* With its own acquisition thread the source runs at the IMU rate,
+     * otherwise don't hog the render thread*/
+    if(!DATA_SOURCE(self)->worker && dt != 0 && dt < (1000/25)) //One update per 1/25 second
+        return false;
+
+    rv = self->replay ? sensors_data_source_replay(self) : sensors_data_source_acquire(self);
+    if(!rv || !ahrs->has_imu)
         return false;
 
-    bno080_hpr(&self->imu, &heading, &pitch, &roll);
     data_source_set_attitude(
         DATA_SOURCE(self), &(AttitudeData){
-            .roll = roll,
-            .pitch = pitch,
-            .heading = heading
+            .roll = ahrs->roll,
+            .pitch = ahrs->pitch,
+            .heading = ahrs->heading
         }
     );
 
-#if !ENABLE_MOCK_GPS
-    gps_sensor_get_fix(&self->gps, &lat, &lon, &alt);
-    data_source_set_location(
-        DATA_SOURCE(self), &(LocationData){
-            .super.latitude = lat,
-            .super.longitude = lon,
-            .altitude = alt*3.281 /*Comes in meters(gps), must be in feets*/
-        }
-    );
-#else
-    data_source_set_location(
-        DATA_SOURCE(self), &(LocationData){
-            .super.latitude = 45.215470,
-            .super.longitude = 5.844828,
-            .altitude = 718.267245
-        }
-    );
-#endif
+    if(ahrs->has_fix){
+        data_source_set_location(
+            DATA_SOURCE(self), &(LocationData){
+                .super.latitude = ahrs->latitude,
+                .super.longitude = ahrs->longitude,
+                .altitude = ahrs->alt * M2FT /*Comes in meters(gps), must be in feets*/
+            }
+        );
+        data_source_set_dynamics(
+            DATA_SOURCE(self), &(DynamicsData){
+                .vertical_speed = ahrs->vs * M2FT,
+                .groundspeed = ahrs->speed * MS2KTS,
+                .track = ahrs->track
+            }
+        );
+    }
 
-    DATA_SOURCE(self)->has_fix = true;
+    data_source_set_fix(DATA_SOURCE(self));
     return true;
 }
@@ -9,6 +9,8 @@
 #define SENSORS_DATA_SOURCE_H
 
 #include "data-source.h"
+#include "ahrs-filter.h"
+#include "sensor-log.h"
 #include "sensors/bno080/bno080.h"
 #include "sensors/gps-sensor.h"
 
@@ -17,9 +19,23 @@ typedef struct{
 
     Bno080 imu;
     GpsSensor gps;
+    uint64_t last_fix; /*GpsSensorFix.t*/
+
+    AhrsFilter ahrs;
+
+    /*Raw readings come from this log instead of the sensors*/
+    SensorLog *replay;
+    SensorLogEntry pending; /*Next entry, read ahead*/
+    bool has_pending;
+    uint64_t replay_start; /*monotonic_ns() when replay started*/
+    uint64_t log_start; /*log time of the first entry*/
+
+    /*Raw readings are also written there*/
+    SensorLog *record;
 }SensorsDataSource;
 
-SensorsDataSource *sensors_data_source_new(void);
-SensorsDataSource *sensors_data_source_init(SensorsDataSource *self);
+SensorsDataSource *sensors_data_source_new(const char *replay);
+SensorsDataSource *sensors_data_source_init(SensorsDataSource *self, const char *replay);
 
+bool sensors_data_source_record(SensorsDataSource *self, const char *filename);
 #endif /* SENSORS_DATA_SOURCE_H */
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <errno.h>
 
+#include "misc.h"
 #include "gps-sensor.h"
 #define GPSD_API_SWITCH 9
 
@@ -17,14 +18,14 @@ static void gps_sensor_set_fix(GpsSensor *self);
 static void gps_sensor_worker(GpsSensor *self);
 
 #if GPSD_API_MAJOR_VERSION >= GPSD_API_SWITCH
-static inline bool timespec_equal(struct timespec *t1, struct timespec *t2)
+static inline double fix_time(struct timespec *t)
 {
-    return t1->tv_sec == t2->tv_sec && t1->tv_nsec == t2->tv_nsec;
+    return t->tv_sec + t->tv_nsec / 1e9;
 }
 #else
-static inline bool timespec_equal(double *t1, double *t2)
+static inline double fix_time(double *t)
 {
-    return *t1 == *t2;
+    return *t;
 }
 #endif
 
@@ -57,73 +58,105 @@ GpsSensor *gps_sensor_init(GpsSensor *self, const char *server, const char *port
     gps_stream(&self->gpsdata, WATCH_ENABLE, NULL);
 
     self->timeout = 5;      /* seconds */
-    self->latitude = NAN;
-
-    pthread_mutex_init(&self->mtx, NULL);
+    self->last_time = NAN;
+
+    seqlock_init(&self->lock);
+    self->fix = (GpsSensorFix){
+        .mode = MODE_NO_FIX,
+        .latitude = NAN,
+        .longitude = NAN,
+        .altitude = NAN,
+        .speed = NAN,
+        .track = NAN,
+        .climb = NAN,
+        .eph = NAN,
+        .epv = NAN
+    };
 
     return self;
 }
 
 GpsSensor *gps_sensor_dispose(GpsSensor *self)
 {
-    pthread_cancel(self->tid);
+    if(self->started){
+        pthread_cancel(self->tid);
+        pthread_join(self->tid, NULL);
+        self->started = false;
+    }
     gps_close(&self->gpsdata);
     return self;
 }
 
 int gps_sensor_start(GpsSensor *self)
 {
-    return pthread_create(&self->tid, NULL, (void*)gps_sensor_worker, self);
+    int rv;
+
+    rv = pthread_create(&self->tid, NULL, (void*)gps_sensor_worker, self);
+    self->started = (rv == 0);
+    return rv;
 }
 
-bool gps_sensor_get_fix(GpsSensor *self, double *latitude, double *longitude, double *altitude)
+/**
+ * @brief Gets the last fix. Never blocks, and can be called from any
+ * thread.
+ *
+ * @param fix Filled with the last fix, see GpsSensorFix.t to know whether
+ * it is a new one. Losing the fix gives a new one as well, with mode
+ * MODE_NO_FIX.
+ * @return true if there is a (2D or 3D) fix, false otherwise
+ */
+bool gps_sensor_get_fix(GpsSensor *self, GpsSensorFix *fix)
 {
-    pthread_mutex_lock(&self->mtx);
-    *latitude = self->latitude;
-    *longitude = self->longitude;
-    *altitude = self->altitude;
-#if 0
-    printf("lat: %f lon: %f alt: %f\n",
-		 self->gpsdata.fix.latitude,
-         self->gpsdata.fix.longitude,
-         self->gpsdata.fix.altitude
-    );
-#endif
-    pthread_mutex_unlock(&self->mtx);
-    return true;
+    unsigned int seq;
+
+    do{
+        seq = seqlock_read_begin(&self->lock);
+        *fix = self->fix;
+    }while(seqlock_read_retry(&self->lock, seq));
+
+    return fix->mode >= MODE_2D;
 }
 
+/*Worker thread only*/
 static void gps_sensor_set_fix(GpsSensor *self)
 {
-#if GPSD_API_MAJOR_VERSION >= GPSD_API_SWITCH
-    struct timespec old_time;
-#else
-    double old_time;
-#endif
-    static double old_lat, old_lon;
-    static bool first = true;
-
-    if(timespec_equal(&(self->gpsdata.fix.time), &old_time) || self->gpsdata.fix.mode < MODE_2D)
+    struct gps_fix_t *gfix = &self->gpsdata.fix;
+    double time;
+
+    if(gfix->mode < MODE_2D){
+        if(self->fix.mode < MODE_2D) /*Still no fix, nothing new*/
+            return;
+        self->last_time = NAN;
+
+        seqlock_write_begin(&self->lock);
+        self->fix.mode = gfix->mode;
+        self->fix.satellites = self->gpsdata.satellites_used;
+        self->fix.t = monotonic_ns();
+        seqlock_write_end(&self->lock);
         return;
-    old_time = self->gpsdata.fix.time;
+    }
 
-    if(self->gpsdata.fix.latitude == old_lat && self->gpsdata.fix.longitude == old_lon)
+    time = fix_time(&gfix->time);
+    if(time == self->last_time)
         return;
-	old_lat = self->gpsdata.fix.latitude;
-	old_lon = self->gpsdata.fix.longitude;
-
-    pthread_mutex_lock(&self->mtx);
-    self->latitude = self->gpsdata.fix.latitude;
-    self->longitude = self->gpsdata.fix.longitude;
-    self->altitude = self->gpsdata.fix.altitude;
-#if 0
-    printf("lat: %f lon: %f alt: %f\n",
-		 self->gpsdata.fix.latitude,
-         self->gpsdata.fix.longitude,
-         self->gpsdata.fix.altitude
-    );
-#endif
-    pthread_mutex_unlock(&self->mtx);
+    self->last_time = time;
+
+    seqlock_write_begin(&self->lock);
+    self->fix = (GpsSensorFix){
+        .mode = gfix->mode,
+        .satellites = self->gpsdata.satellites_used,
+        .time = time,
+        .t = monotonic_ns(),
+        .latitude = gfix->latitude,
+        .longitude = gfix->longitude,
+        .altitude = (gfix->mode >= MODE_3D) ? gfix->altitude : NAN,
+        .speed = gfix->speed,
+        .track = gfix->track,
+        .climb = gfix->climb,
+        .eph = gfix->eph,
+        .epv = gfix->epv
+    };
+    seqlock_write_end(&self->lock);
 }
 
 /*loosly modeled after gpsd's gps_mainloop*/
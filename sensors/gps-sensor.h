@@ -7,21 +7,45 @@
  */
 #ifndef GPS_SENSOR_H
 #define GPS_SENSOR_H
+#include <stdint.h>
+#include <stdbool.h>
 #include <time.h>
 #include <pthread.h>
 
 #include <gps.h>
 
+#include "seqlock.h"
+
+typedef struct{
+    /* gpsd's MODE_NO_FIX, MODE_2D or MODE_3D. Losing the fix is published
+     * as well: the position is then the last known one*/
+    int mode;
+    int satellites; /*used in the solution*/
+    double time; /*s, UTC, as given by the receiver*/
+    uint64_t t; /*monotonic_ns() at reception, 0 until the first fix*/
+
+    double latitude; /*degrees*/
+    double longitude; /*degrees*/
+    double altitude; /*m, NAN in 2D*/
+    double speed; /*ground speed, m/s*/
+    double track; /*degrees true*/
+    double climb; /*m/s*/
+    double eph; /*horizontal error estimate, m*/
+    double epv; /*vertical error estimate, m*/
+}GpsSensorFix;
+
 typedef struct{
     struct gps_data_t gpsdata;
     time_t timeout;
 
     pthread_t tid;
-    pthread_mutex_t mtx;
+    bool started;
+
+    double last_time; /*worker only*/
 
-    double latitude;
-    double longitude;
-    double altitude;
+    /*Written by the worker, read by anyone*/
+    SeqLock lock;
+    GpsSensorFix fix;
 }GpsSensor;
 
 GpsSensor *gps_sensor_new(const char *server, const char *port);
@@ -29,5 +53,5 @@ GpsSensor *gps_sensor_init(GpsSensor *self, const char *server, const char *port
 GpsSensor *gps_sensor_dispose(GpsSensor *self);
 
 int gps_sensor_start(GpsSensor *self);
-bool gps_sensor_get_fix(GpsSensor *self, double *latitude, double *longitude, double *altitude);
+bool gps_sensor_get_fix(GpsSensor *self, GpsSensorFix *fix);
 #endif /* GPS_SENSOR_H */
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Single writer/many readers sequence lock for small values that are
+ * read much more often than written. The writer never waits, readers
+ * never take a lock: they copy the value and start over if the writer
+ * has been there in the meantime.
+ *
+ * The sequence is odd while a write is in progress.
+ *
+ * Writer:
+ *   seqlock_write_begin(&lock);
+ *   shared = value;
+ *   seqlock_write_end(&lock);
+ *
+ * Reader:
+ *   do{
+ *       seq = seqlock_read_begin(&lock);
+ *       copy = shared;
+ *   }while(seqlock_read_retry(&lock, seq));
+ */
+typedef struct{
+    atomic_uint seq;
+}SeqLock;
+
+static inline SeqLock *seqlock_init(SeqLock *self)
+{
+    atomic_init(&self->seq, 0);
+    return self;
+}
+
+static inline void seqlock_write_begin(SeqLock *self)
+{
+    atomic_fetch_add_explicit(&self->seq, 1, memory_order_relaxed);
+    /*The odd sequence must be visible before any of the data stores*/
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void seqlock_write_end(SeqLock *self)
+{
+    atomic_fetch_add_explicit(&self->seq, 1, memory_order_release);
+}
+
+static inline unsigned int seqlock_read_begin(SeqLock *self)
+{
+    unsigned int seq;
+
+    while((seq = atomic_load_explicit(&self->seq, memory_order_acquire)) & 1)
+        ; /*Writes are a couple of stores long, just spin*/
+    return seq;
+}
+
+/**
+ * @brief Tells whether the value copied since @p seq may be torn.
+ *
+ * @return true if the copy must be done again
+ */
+static inline bool seqlock_read_retry(SeqLock *self, unsigned int seq)
+{
+    /*The data loads must be done before checking the sequence again*/
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&self->seq, memory_order_relaxed) != seq;
+}
+#endif /* SEQLOCK_H */
@@ -21,6 +21,7 @@
 
 static void side_panel_render(SidePanel *self, Uint32 dt, RenderContext *ctx);
 static BaseGaugeOps side_panel_ops = {
+    .name = "SidePanel",
     .render = (RenderFunc)side_panel_render,
     .update_state = (StateUpdateFunc)NULL,
     .dispose = (DisposeFunc)NULL
@@ -57,36 +58,6 @@ SidePanel *side_panel_init(SidePanel *self, int width, int height)
         width,
         height
     );
-#if 0
-    self->egt = elevator_gauge_new(true,
-        Left,
-        resource_manager_get_font(TERMINUS_12), SDL_WHITE,
-        300, 2300, 300,
-        15, 80,
-        0, NULL
-    );
-    self->egt_txt = text_gauge_new("EGT °F", false, 92 - 10, 12);
-    text_gauge_set_static_font(self->egt_txt,
-        resource_manager_get_static_font(TERMINUS_12,
-            &SDL_WHITE,
-            2, PCF_ALPHA, PCF_DIGITS
-        )
-    );
-    self->locations[EGT] = (SDL_Rect){
-        .x = 0,
-        .y = 0,
-        .w = BASE_GAUGE(self->egt)->w,
-        .h = BASE_GAUGE(self->egt)->h
-    };
-    self->locations[EGT_TXT] = (SDL_Rect){
-        .x = 0,
-        .y = self->locations[EGT].y + self->locations[EGT].h + 1,
-        .w =  BASE_GAUGE(self->egt_txt)->w,
-        .h =  BASE_GAUGE(self->egt_txt)->h,
-    };
-#else
-     self->locations[EGT] = self->locations[EGT_TXT] = (SDL_Rect){0,0,0,0};
-#endif
     self->rpm = elevator_gauge_new(true,
         Left,
         resource_manager_get_font(TERMINUS_12), SDL_WHITE,
@@ -117,8 +88,8 @@ SidePanel *side_panel_init(SidePanel *self, int width, int height)
         )
     );
     self->locations[RPM] = (SDL_Rect){
-        .x = 0,
-        .y = SDLExt_RectLastY(&self->locations[EGT_TXT]) + 4,
+        .x = 2,
+        .y = 3,
         .w = base_gauge_w(BASE_GAUGE(self->rpm)),
         .h = base_gauge_h(BASE_GAUGE(self->rpm))
     };
@@ -130,6 +101,51 @@ SidePanel *side_panel_init(SidePanel *self, int width, int height)
     };
 
 
+    /* Manifold pressure, EGT and bus voltage: text readouts stacked in
+     * the room left by the RPM bar on its right*/
+    int col_x = 2 + base_gauge_w(BASE_GAUGE(self->rpm)) + 4;
+    int col_w = width - col_x - 2;
+    struct{
+        TextGauge **txt, **value;
+        const char *label;
+        SidePanelLocations txt_loc, value_loc;
+    }column[] = {
+        {&self->man_press_txt, &self->man_press, "MAP", MAN_PRESS_TXT, MAN_PRESS},
+        {&self->egt_txt, &self->egt, "EGT", EGT_TXT, EGT},
+        {&self->volts_txt, &self->volts, "VOLTS", VOLTS_TXT, VOLTS}
+    };
+    int col_y = self->locations[RPM].y;
+    for(int i = 0; i < sizeof(column)/sizeof(column[0]); i++){
+        *column[i].txt = text_gauge_new(column[i].label, false, col_w, 12);
+        text_gauge_set_static_font(*column[i].txt,
+            resource_manager_get_static_font(TERMINUS_12,
+                &SDL_WHITE,
+                2, PCF_ALPHA, PCF_DIGITS
+            )
+        );
+        *column[i].value = text_gauge_new("--", false, col_w, 12);
+        text_gauge_set_static_font(*column[i].value,
+            resource_manager_get_static_font(TERMINUS_12,
+                &SDL_WHITE,
+                3, PCF_ALPHA, PCF_DIGITS, ".-"
+            )
+        );
+        self->locations[column[i].txt_loc] = (SDL_Rect){
+            .x = col_x,
+            .y = col_y,
+            .w = base_gauge_w(BASE_GAUGE(*column[i].txt)),
+            .h = base_gauge_h(BASE_GAUGE(*column[i].txt))
+        };
+        self->locations[column[i].value_loc] = (SDL_Rect){
+            .x = col_x,
+            .y = SDLExt_RectLastY(&self->locations[column[i].txt_loc]) + 2,
+            .w = base_gauge_w(BASE_GAUGE(*column[i].value)),
+            .h = base_gauge_h(BASE_GAUGE(*column[i].value))
+        };
+        col_y = SDLExt_RectLastY(&self->locations[column[i].value_loc]) + GROUP_SPACE;
+    }
+
+
     /*Fuel flow*/
     self->fuel_flow_txt = text_gauge_new("FUEL FLOW", false, 92 - 10, 12);
     text_gauge_set_static_font(self->fuel_flow_txt,
@@ -381,13 +397,23 @@ SidePanel *side_panel_init(SidePanel *self, int width, int height)
 
 #if 1
     SDL_Rect reference = {0,0,base_gauge_w(BASE_GAUGE(self)),base_gauge_h(BASE_GAUGE(self))};
-    for(int i = 0; i < NSidePanelLocations; i++){
+    for(int i = RPM_TXT; i < NSidePanelLocations; i++){
         int tmpy = self->locations[i].y;
         SDLExt_RectAlign(&self->locations[i], &reference, HALIGN_CENTER);
         self->locations[i].y = tmpy;
 
     }
 #endif
+    for(int i = 0; i < sizeof(column)/sizeof(column[0]); i++){
+        base_gauge_add_child(BASE_GAUGE(self), BASE_GAUGE(*column[i].txt),
+            self->locations[column[i].txt_loc].x,
+            self->locations[column[i].txt_loc].y
+        );
+        base_gauge_add_child(BASE_GAUGE(self), BASE_GAUGE(*column[i].value),
+            self->locations[column[i].value_loc].x,
+            self->locations[column[i].value_loc].y
+        );
+    }
     base_gauge_add_child(BASE_GAUGE(self), BASE_GAUGE(self->rpm_txt),
         self->locations[RPM_TXT].x,
         self->locations[RPM_TXT].y
@@ -464,6 +490,42 @@ void side_panel_set_fuel_flow(SidePanel *self, float value)
     );
 }
 
+void side_panel_set_man_press(SidePanel *self, float value)
+{
+    if(isnan(value)){
+        text_gauge_set_value(self->man_press, "--");
+        return;
+    }
+    text_gauge_set_value_formatn(self->man_press,
+        5,
+        "%0.1f", value
+    );
+}
+
+void side_panel_set_egt(SidePanel *self, float value)
+{
+    if(isnan(value)){
+        text_gauge_set_value(self->egt, "--");
+        return;
+    }
+    text_gauge_set_value_formatn(self->egt,
+        5,
+        "%d", (int)value
+    );
+}
+
+void side_panel_set_volts(SidePanel *self, float value)
+{
+    if(isnan(value)){
+        text_gauge_set_value(self->volts, "--");
+        return;
+    }
+    text_gauge_set_value_formatn(self->volts,
+        5,
+        "%0.1f", value
+    );
+}
+
 
 void side_panel_engine_data_changed(SidePanel *self, EngineData *newv)
 {
@@ -474,6 +536,9 @@ void side_panel_engine_data_changed(SidePanel *self, EngineData *newv)
     side_panel_set_cht(self, newv->cht);
     side_panel_set_fuel_px(self, newv->fuel_px);
     side_panel_set_fuel_qty(self, newv->fuel_qty);
+    side_panel_set_man_press(self, newv->man_press);
+    side_panel_set_egt(self, newv->egt);
+    side_panel_set_volts(self, newv->volts);
 }
 
 static void side_panel_render(SidePanel *self, Uint32 dt, RenderContext *ctx)
@@ -15,8 +15,14 @@
 #include "data-source.h"
 
 typedef enum{
-    EGT,
+    MAN_PRESS_TXT,
+    MAN_PRESS,
+
     EGT_TXT,
+    EGT,
+
+    VOLTS_TXT,
+    VOLTS,
 
     RPM,
     RPM_TXT,
@@ -45,8 +51,15 @@ typedef enum{
 typedef struct{
     BaseGauge super;
 
-    ElevatorGauge *egt;
+    /*Column next to the RPM gauge*/
+    TextGauge *man_press_txt;
+    TextGauge *man_press;
+
     TextGauge *egt_txt;
+    TextGauge *egt;
+
+    TextGauge *volts_txt;
+    TextGauge *volts;
 
     ElevatorGauge *rpm;
     TextGauge *rpm_txt;
@@ -77,6 +90,9 @@ SidePanel *side_panel_init(SidePanel *self, int width, int height);
 
 void side_panel_set_rpm(SidePanel *self, float value);
 void side_panel_set_fuel_flow(SidePanel *self, float value);
+void side_panel_set_man_press(SidePanel *self, float value);
+void side_panel_set_egt(SidePanel *self, float value);
+void side_panel_set_volts(SidePanel *self, float value);
 
 static inline void side_panel_set_oil_temp(SidePanel *self, float value)
 {
@@ -6,16 +6,22 @@
  * SPDX-License-Identifier: GPL-2.0-only
  */
 #include "stratux-data-source.h"
-#include "http-request.h"
+#include "stratux-situation.h"
 
 #include "misc.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
-//#define API_ENDPOINT "http://127.0.0.1/getSituation"
-#define API_ENDPOINT "http://192.168.10.1/getSituation"
+#define STRATUX_WS_PATH "/situation"
+#define STRATUX_HTTP_PATH "/getSituation"
 
-char *json_get_value(const char *json, const char *key, size_t *keylen);
-double json_get_double_value(const char *json, const char *key, const char *nan_value);
+#define STRATUX_CONNECT_TIMEOUT 2000 /*ms*/
+#define STRATUX_HTTP_TIMEOUT 1000 /*ms, whole /getSituation request*/
+#define STRATUX_RECV_TIMEOUT 100 /*ms, bounds the time to notice a stop request*/
+#define STRATUX_STALE_TIMEOUT 5000 /*ms without a message before reconnecting*/
+#define STRATUX_RETRY_DELAY 500 /*ms between two connection attempts*/
 
 
 static bool stratux_data_source_frame(StratuxDataSource *self, uint32_t dt);
@@ -26,13 +32,13 @@ static DataSourceOps stratux_data_source_ops = {
 };
 
 
-StratuxDataSource *stratux_data_source_new(int port)
+StratuxDataSource *stratux_data_source_new(const char *host, StratuxTransport transport)
 {
     StratuxDataSource *self;
 
     self = calloc(1, sizeof(StratuxDataSource));
     if(self){
-        if(!stratux_data_source_init(self)){
+        if(!stratux_data_source_init(self, host, transport)){
             free(self);
             return NULL;
         }
@@ -40,50 +46,72 @@ StratuxDataSource *stratux_data_source_new(int port)
     return self;
 }
 
-StratuxDataSource *stratux_data_source_init(StratuxDataSource *self)
+/**
+ * @brief Sets up a StratuxDataSource
+ *
+ * @param host Stratux address, with an optional port: "192.168.10.1",
+ * "127.0.0.1:8080". NULL for the default address.
+ * @param transport STRATUX_WEBSOCKET to get updates pushed as soon as
+ * the Stratux has them, STRATUX_HTTP to poll.
+ */
+StratuxDataSource *stratux_data_source_init(StratuxDataSource *self, const char *host, StratuxTransport transport)
 {
+    char url[128];
+    char *colon;
+
     if(!data_source_init(DATA_SOURCE(self), &stratux_data_source_ops))
         return NULL;
-    self->buf = http_buffer_new(0);
-    if(!self->buf)
-        return NULL;
+
+    self->transport = transport;
+    snprintf(self->host, sizeof(self->host), "%s", host ? host : STRATUX_DEFAULT_HOST);
+    self->port = 80;
+    colon = strchr(self->host, ':');
+    if(colon){
+        *colon = '\0';
+        self->port = atoi(colon + 1);
+    }
+
+    ws_client_init(&self->ws);
+    if(transport == STRATUX_HTTP){
+        snprintf(url, sizeof(url), "http://%s:%d%s", self->host, self->port, STRATUX_HTTP_PATH);
+        self->http = http_client_new(url);
+        if(!self->http)
+            return NULL;
+        http_client_set_timeouts(self->http, STRATUX_CONNECT_TIMEOUT, STRATUX_HTTP_TIMEOUT);
+    }
 
     return self;
 }
 
 static StratuxDataSource *stratux_data_source_dispose(StratuxDataSource *self)
 {
-    if(self->buf){
-        if(self->buf->buffer)
-            free(self->buf->buffer);
-        free(self->buf);
-    }
+    ws_client_dispose(&self->ws);
+    if(self->http)
+        http_client_free(self->http);
     return self;
 }
 
-
-static bool stratux_data_source_frame(StratuxDataSource *self, uint32_t dt)
+static bool stratux_data_source_apply(StratuxDataSource *self, const char *json, size_t len)
 {
-    bool rv;
+    StratuxSituation situation;
     double lat, lon, alt;
     double roll, pitch,heading, mheading;
     double vertical_speed_gps;
-    double vertical_speed_baro;
-
-    rv = http_request(API_ENDPOINT, &self->buf);
-    if(!rv) return false;
 
-    lat = json_get_double_value(self->buf->buffer, "GPSLatitude", NULL);
-    lon = json_get_double_value(self->buf->buffer, "GPSLongitude", NULL);
-    alt = json_get_double_value(self->buf->buffer, "GPSHeightAboveEllipsoid", NULL);
+    if(stratux_situation_parse(&situation, json, len) < 0){
+        printf("%s: malformed situation, ignoring\n", __FUNCTION__);
+        return false;
+    }
+    lat = situation.gps_latitude;
+    lon = situation.gps_longitude;
+    alt = situation.gps_height_above_ellipsoid;
 
-    roll = json_get_double_value(self->buf->buffer, "AHRSRoll", "3276.7");
-    pitch = json_get_double_value(self->buf->buffer, "AHRSPitch", "3276.7");
-    heading = json_get_double_value(self->buf->buffer, "AHRSGyroHeading", "3276.7");
-    mheading = json_get_double_value(self->buf->buffer, "AHRSMagHeading", "3276.7");
+    roll = situation.ahrs_roll;
+    pitch = situation.ahrs_pitch;
+    heading = situation.ahrs_gyro_heading;
+    mheading = situation.ahrs_mag_heading;
 
-    vertical_speed_gps = json_get_double_value(self->buf->buffer, "GPSVerticalSpeed", NULL);
-    vertical_speed_baro = json_get_double_value(self->buf->buffer, "BaroVerticalSpeed", NULL);
+    vertical_speed_gps = situation.gps_vertical_speed;
 
     if(!isnan(heading))
         heading = fmod(heading, 360.0);
@@ -99,24 +127,27 @@ static bool stratux_data_source_frame(StratuxDataSource *self, uint32_t dt)
 
     data_source_set_dynamics(
         DATA_SOURCE(self), &(DynamicsData){
-            .airspeed = DATA_SOURCE(self)->dynamics.airspeed,
+            .airspeed = self->airspeed,
             .vertical_speed = vertical_speed_gps,
-            .slip_rad = DATA_SOURCE(self)->dynamics.slip_rad
+            .slip_rad = self->slip_rad
         }
     );
 
 
-    float new_heading;
+    if(!isnan(roll))
+        self->roll = roll;
+    if(!isnan(pitch))
+        self->pitch = pitch;
     if(!isnan(heading))
-        new_heading = fmod(heading,360.0);
+        self->heading = heading;
     else if(!isnan(mheading))
-        new_heading = fmod(mheading,360.0);
+        self->heading = mheading;
 
     data_source_set_attitude(
         DATA_SOURCE(self), &(AttitudeData){
-            .roll = roll,
-            .pitch = pitch,
-            .heading = new_heading
+            .roll = self->roll,
+            .pitch = self->pitch,
+            .heading = self->heading
         }
     );
 
@@ -127,51 +158,83 @@ static bool stratux_data_source_frame(StratuxDataSource *self, uint32_t dt)
         roll, pitch, heading, mheading
     );
 #endif
-    self->buf->len = 0;
 
-    DATA_SOURCE(self)->has_fix = true;
+    data_source_set_fix(DATA_SOURCE(self));
     return true;
 }
 
-/**
- * This is very primitive and won't work with complex (i.e.
- * nested arrays/objects) types
- *
+/* Polled from the main loop when there is no acquisition thread: never
+ * stall the rendering, just report that nothing new came in yet.
  */
-char *json_get_value(const char *json, const char *key, size_t *keylen)
+static bool stratux_data_source_poll(StratuxDataSource *self)
 {
-    char *rv;
-    char *kend;
-
-    rv = strstr(json, key);
-    if(!rv) return NULL;
-
-    rv = strchr(rv, ':');
-    if(!rv) return NULL;
+    HttpResult res;
 
-    rv = nibble_spaces(rv+1, 0);
-    if(!rv) return NULL;
+    http_client_set_blocking(self->http, DATA_SOURCE(self)->worker != NULL);
+    res = http_client_get(self->http);
+    if(res != HTTP_OK)
+        return false;
 
-    kend = strchr(rv, ',');
-    if(!kend)
-        kend = strchr(rv, '}');
-    if(kend && keylen)
-        *keylen = kend - rv;
-
-    return rv;
+    return stratux_data_source_apply(self, self->http->buf->buffer, self->http->buf->len);
 }
 
-double json_get_double_value(const char *json, const char *key, const char *nan_value)
+/* Blocks until the Stratux pushes something (or STRATUX_RECV_TIMEOUT),
+ * meant to run on the acquisition thread. Connection loss is handled
+ * here: the link is re-established on the next calls, at most every
+ * STRATUX_RETRY_DELAY.
+ */
+static bool stratux_data_source_stream(StratuxDataSource *self)
 {
-    double rv;
-    char *strval;
+    const char *payload;
     size_t len;
+    WsResult res;
+    bool rv;
 
-    strval = json_get_value(json, key, &len);
-    if(!strval) return NAN;
+    if(!ws_client_connected(&self->ws)){
+        if(!ws_client_connect(&self->ws, self->host, self->port, STRATUX_WS_PATH, STRATUX_CONNECT_TIMEOUT)){
+            if(!self->warned){
+                printf("%s: couldn't connect to ws://%s:%d%s, retrying\n",
+                    __FUNCTION__, self->host, self->port, STRATUX_WS_PATH);
+                self->warned = true;
+            }
+            usleep(STRATUX_RETRY_DELAY * 1000);
+            return false;
+        }
+        printf("%s: %s to ws://%s:%d%s\n", __FUNCTION__,
+            self->connected_once ? "reconnected" : "connected",
+            self->host, self->port, STRATUX_WS_PATH);
+        self->connected_once = true;
+        self->warned = false;
+        self->last_message = monotonic_ns();
+    }
 
-    if(nan_value && !strncmp(strval, nan_value, len)) return NAN;
+    res = ws_client_recv(&self->ws, &payload, &len, STRATUX_RECV_TIMEOUT);
+    if(res == WS_TIMEOUT){
+        if(monotonic_ns() - self->last_message > STRATUX_STALE_TIMEOUT * 1000000ULL){
+            printf("%s: no situation update for %d ms, reconnecting\n", __FUNCTION__, STRATUX_STALE_TIMEOUT);
+            ws_client_close(&self->ws);
+        }
+        return false;
+    }
+    if(res == WS_CLOSED){
+        printf("%s: connection lost, reconnecting\n", __FUNCTION__);
+        return false;
+    }
+
+    /*Catch up with anything already queued, only the newest one will
+     * be published*/
+    rv = false;
+    do{
+        rv |= stratux_data_source_apply(self, payload, len);
+    }while(ws_client_recv(&self->ws, &payload, &len, 0) == WS_MESSAGE);
+    self->last_message = monotonic_ns();
 
-    return strtod(strval, NULL);
+    return rv;
 }
 
+static bool stratux_data_source_frame(StratuxDataSource *self, uint32_t dt)
+{
+    if(self->transport == STRATUX_WEBSOCKET)
+        return stratux_data_source_stream(self);
+    return stratux_data_source_poll(self);
+}
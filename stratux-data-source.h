@@ -8,15 +8,41 @@
 #ifndef STRATUX_DATA_SOURCE_H
 #define STRATUX_DATA_SOURCE_H
 #include "data-source.h"
-#include "http-buffer.h"
+#include "http-client.h"
+#include "ws-client.h"
+
+#define STRATUX_DEFAULT_HOST "192.168.10.1"
+
+typedef enum{
+    STRATUX_WEBSOCKET, /*Pushed updates on /situation*/
+    STRATUX_HTTP       /*Polling /getSituation*/
+}StratuxTransport;
 
 typedef struct{
     DataSource super;
 
-    HttpBuffer *buf;
+    StratuxTransport transport;
+    char host[64];
+    int port;
+
+    HttpClient *http;
+
+    WsClient ws;
+    uint64_t last_message; /*monotonic ns*/
+    bool connected_once;
+    bool warned;
+
+    /*Last valid ones, the AHRS reports NaN while it is not ready*/
+    float roll;
+    float pitch;
+    float heading; /*gyro or mag*/
+    /*Not reported by the Stratux: kept here rather than read back from
+     * DataSource, which belongs to the rendering thread*/
+    float airspeed;
+    float slip_rad;
 }StratuxDataSource;
 
 
-StratuxDataSource *stratux_data_source_new();
-StratuxDataSource *stratux_data_source_init(StratuxDataSource *self);
+StratuxDataSource *stratux_data_source_new(const char *host, StratuxTransport transport);
+StratuxDataSource *stratux_data_source_init(StratuxDataSource *self, const char *host, StratuxTransport transport);
 #endif /* STRATUX_DATA_SOURCE_H */
@@ -0,0 +1,170 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+/*
+ * Microbenchmark of the Stratux /getSituation parsing: single pass
+ * tokenizer (stratux-situation.c) against the previous approach of one
+ * strstr() scan of the whole response per wanted key.
+ *
+ * Usage: stratux-json-bench [-n iterations] [response.json ...]
+ * Responses can be recorded with:
+ *   curl -o situation.json http://192.168.10.1/getSituation
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "misc.h"
+#include "stratux-situation.h"
+
+#define DEFAULT_ITERATIONS 100000
+#define DEFAULT_RESPONSE "resources/stratux/situation.json"
+
+/*Previous implementation, kept as the baseline*/
+static const char *strstr_get_value(const char *json, const char *key, size_t *keylen)
+{
+    const char *rv;
+    const char *kend;
+
+    rv = strstr(json, key);
+    if(!rv) return NULL;
+
+    rv = strchr(rv, ':');
+    if(!rv) return NULL;
+
+    for(rv++; isspace(*rv); rv++);
+
+    kend = strchr(rv, ',');
+    if(!kend)
+        kend = strchr(rv, '}');
+    if(kend && keylen)
+        *keylen = kend - rv;
+
+    return rv;
+}
+
+static double strstr_get_double_value(const char *json, const char *key, const char *nan_value)
+{
+    const char *strval;
+    size_t len = 0;
+
+    strval = strstr_get_value(json, key, &len);
+    if(!strval) return NAN;
+
+    if(nan_value && !strncmp(strval, nan_value, len)) return NAN;
+
+    return strtod(strval, NULL);
+}
+
+static void strstr_parse(StratuxSituation *self, const char *json)
+{
+    self->gps_latitude = strstr_get_double_value(json, "GPSLatitude", NULL);
+    self->gps_longitude = strstr_get_double_value(json, "GPSLongitude", NULL);
+    self->gps_height_above_ellipsoid = strstr_get_double_value(json, "GPSHeightAboveEllipsoid", NULL);
+    self->ahrs_roll = strstr_get_double_value(json, "AHRSRoll", "3276.7");
+    self->ahrs_pitch = strstr_get_double_value(json, "AHRSPitch", "3276.7");
+    self->ahrs_gyro_heading = strstr_get_double_value(json, "AHRSGyroHeading", "3276.7");
+    self->ahrs_mag_heading = strstr_get_double_value(json, "AHRSMagHeading", "3276.7");
+    self->gps_vertical_speed = strstr_get_double_value(json, "GPSVerticalSpeed", NULL);
+    self->baro_vertical_speed = strstr_get_double_value(json, "BaroVerticalSpeed", NULL);
+}
+
+static char *load_file(const char *filename, size_t *len)
+{
+    FILE *fp;
+    char *rv;
+    long size;
+
+    fp = fopen(filename, "rb");
+    if(!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    rv = malloc(size + 1);
+    if(rv){
+        *len = fread(rv, 1, size, fp);
+        rv[*len] = '\0';
+    }
+    fclose(fp);
+    return rv;
+}
+
+static bool same(double a, double b)
+{
+    return (isnan(a) && isnan(b)) || a == b;
+}
+
+static void bench_response(const char *filename, long iterations)
+{
+    StratuxSituation a, b;
+    volatile double sink = 0;
+    uint64_t start, t_strstr, t_single;
+    size_t len;
+    char *json;
+
+    json = load_file(filename, &len);
+    if(!json){
+        printf("%s: couldn't read\n", filename);
+        return;
+    }
+
+    start = monotonic_ns();
+    for(long i = 0; i < iterations; i++){
+        strstr_parse(&a, json);
+        sink += a.ahrs_roll;
+    }
+    t_strstr = monotonic_ns() - start;
+
+    start = monotonic_ns();
+    for(long i = 0; i < iterations; i++){
+        stratux_situation_parse(&b, json, len);
+        sink += b.ahrs_roll;
+    }
+    t_single = monotonic_ns() - start;
+
+    printf("%s (%zu bytes, %d fields found)\n", filename, len, stratux_situation_parse(&b, json, len));
+    printf("  strstr:      %8.1f ns/parse\n", (double)t_strstr / iterations);
+    printf("  single pass: %8.1f ns/parse (x%.1f)\n",
+        (double)t_single / iterations, (double)t_strstr / t_single
+    );
+
+#define CHECK(f) if(!same(a.f, b.f)) printf("  " #f " differs: strstr %f, single pass %f\n", a.f, b.f)
+    CHECK(gps_latitude);
+    CHECK(gps_longitude);
+    CHECK(gps_height_above_ellipsoid);
+    CHECK(gps_vertical_speed);
+    CHECK(baro_vertical_speed);
+    CHECK(ahrs_roll);
+    CHECK(ahrs_pitch);
+    CHECK(ahrs_gyro_heading);
+    CHECK(ahrs_mag_heading);
+#undef CHECK
+    free(json);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = DEFAULT_ITERATIONS;
+    int nfiles = 0;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-n") && i+1 < argc){
+            iterations = strtol(argv[++i], NULL, 10);
+            continue;
+        }
+        bench_response(argv[i], iterations);
+        nfiles++;
+    }
+    if(!nfiles)
+        bench_response(DEFAULT_RESPONSE, iterations);
+    return 0;
+}
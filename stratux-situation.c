@@ -0,0 +1,255 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "stratux-situation.h"
+
+typedef struct{
+    const char *key;
+    size_t keylen;
+    size_t offset;
+    bool ahrs; /*STRATUX_AHRS_INVALID means NAN*/
+}SituationField;
+
+#define FIELD(k, m, a) {k, sizeof(k)-1, offsetof(StratuxSituation, m), a}
+static const SituationField fields[] = {
+    FIELD("GPSLatitude", gps_latitude, false),
+    FIELD("GPSLongitude", gps_longitude, false),
+    FIELD("GPSHeightAboveEllipsoid", gps_height_above_ellipsoid, false),
+    FIELD("GPSVerticalSpeed", gps_vertical_speed, false),
+    FIELD("BaroVerticalSpeed", baro_vertical_speed, false),
+    FIELD("AHRSRoll", ahrs_roll, true),
+    FIELD("AHRSPitch", ahrs_pitch, true),
+    FIELD("AHRSGyroHeading", ahrs_gyro_heading, true),
+    FIELD("AHRSMagHeading", ahrs_mag_heading, true),
+};
+#define N_FIELDS (sizeof(fields)/sizeof(fields[0]))
+
+/* Bit n set when a wanted key is n chars long, rejects most
+ * keys without any string comparison. All wanted keys are < 32 chars*/
+static uint32_t key_lengths = 0;
+
+/*Powers of ten that are exactly representable as doubles*/
+static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22
+};
+
+/*Character classes, to avoid chains of comparisons in the hot loops*/
+#define CC_SPACE 0x1
+#define CC_END_SCALAR 0x2 /*ends a number/true/false/null*/
+static const uint8_t char_class[256] = {
+    [' '] = CC_SPACE | CC_END_SCALAR,
+    ['\t'] = CC_SPACE | CC_END_SCALAR,
+    ['\n'] = CC_SPACE | CC_END_SCALAR,
+    ['\r'] = CC_SPACE | CC_END_SCALAR,
+    [','] = CC_END_SCALAR,
+    ['}'] = CC_END_SCALAR,
+    [']'] = CC_END_SCALAR,
+};
+
+static inline const char *skip_spaces(const char *p, const char *end)
+{
+    while(p < end && (char_class[(uint8_t)*p] & CC_SPACE))
+        p++;
+    return p;
+}
+
+/*@p p points to the opening quote, returns the closing one*/
+static const char *skip_string(const char *p, const char *end)
+{
+    const char *q;
+
+    for(p++; p < end; p = q + 1){
+        q = memchr(p, '"', end - p);
+        if(!q)
+            return NULL;
+        /*Escaped if preceded by an odd number of backslashes*/
+        const char *bs = q;
+        while(bs > p && bs[-1] == '\\')
+            bs--;
+        if(!((q - bs) & 1))
+            return q;
+    }
+    return NULL;
+}
+
+/*Returns the first char past the value starting at @p p*/
+static const char *skip_value(const char *p, const char *end)
+{
+    int depth;
+
+    if(p >= end)
+        return NULL;
+
+    if(*p == '"'){
+        p = skip_string(p, end);
+        return p ? p + 1 : NULL;
+    }
+
+    if(*p != '{' && *p != '['){
+        /*number, true, false, null*/
+        while(p < end && !(char_class[(uint8_t)*p] & CC_END_SCALAR))
+            p++;
+        return p;
+    }
+
+    /*Nested object/array, not interested in the contents*/
+    for(depth = 0; p < end; p++){
+        switch(*p){
+            case '"':
+                p = skip_string(p, end);
+                if(!p)
+                    return NULL;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if(!--depth)
+                    return p + 1;
+                break;
+        }
+    }
+    return NULL;
+}
+
+static const SituationField *lookup_field(const char *key, size_t len)
+{
+    if(len >= 32 || !(key_lengths & (1u << len)))
+        return NULL;
+    for(int i = 0; i < N_FIELDS; i++){
+        if(fields[i].keylen == len && !memcmp(fields[i].key, key, len))
+            return &fields[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parses a plain decimal number (-12.5, 3276.7), falls back on
+ * strtod for anything else (exponents, more than 15 significant digits,
+ * ...) or to get the exact same rounding.
+ *
+ * The fast path is exact: both the mantissa and the power of ten are
+ * exactly representable, and a single division is correctly rounded.
+ *
+ * @return false if @p p doesn't start with a number
+ */
+static bool parse_number(const char *p, const char *end, double *value)
+{
+    const char *q = p;
+    uint64_t mantissa = 0;
+    int ndigits = 0, nfrac = 0;
+    bool negative = false;
+    char num[32];
+
+    if(q < end && (*q == '-' || *q == '+'))
+        negative = (*q++ == '-');
+    for(; q < end && *q >= '0' && *q <= '9'; q++, ndigits++)
+        mantissa = mantissa * 10 + (*q - '0');
+    if(q < end && *q == '.'){
+        for(q++; q < end && *q >= '0' && *q <= '9'; q++, ndigits++, nfrac++)
+            mantissa = mantissa * 10 + (*q - '0');
+    }
+    if(ndigits && ndigits <= 15 && (q == end || (*q != 'e' && *q != 'E'))){
+        *value = (double)mantissa / pow10[nfrac];
+        if(negative)
+            *value = -*value;
+        return true;
+    }
+
+    /*strtod needs a terminator*/
+    if(end - p >= sizeof(num))
+        return false;
+    memcpy(num, p, end - p);
+    num[end - p] = '\0';
+    *value = strtod(num, (char**)&q);
+    return q != num;
+}
+
+/**
+ * @brief Extracts the fields we use from a /getSituation response, in a
+ * single pass and without allocating anything. Keys are matched
+ * exactly, nested values are skipped.
+ *
+ * @param json The response, doesn't need to be NULL-terminated
+ * @param len Length of @p json
+ * @return The number of fields found, -1 if the response isn't a
+ * well-formed JSON object. Missing fields are set to NAN.
+ */
+int stratux_situation_parse(StratuxSituation *self, const char *json, size_t len)
+{
+    const char *p, *end;
+    int found = 0;
+
+    if(!key_lengths){
+        for(int i = 0; i < N_FIELDS; i++)
+            key_lengths |= 1u << fields[i].keylen;
+    }
+    for(int i = 0; i < N_FIELDS; i++)
+        *(double*)((char*)self + fields[i].offset) = NAN;
+
+    end = json + len;
+    p = skip_spaces(json, end);
+    if(p == end || *p != '{')
+        return -1;
+    p = skip_spaces(p+1, end);
+    if(p < end && *p == '}')
+        return 0;
+
+    while(p < end){
+        const SituationField *field;
+        const char *key, *kend, *vend;
+
+        if(*p != '"')
+            return -1;
+        key = p + 1;
+        kend = skip_string(p, end);
+        if(!kend)
+            return -1;
+
+        p = skip_spaces(kend+1, end);
+        if(p == end || *p != ':')
+            return -1;
+        p = skip_spaces(p+1, end);
+
+        vend = skip_value(p, end);
+        if(!vend)
+            return -1;
+
+        field = lookup_field(key, kend - key);
+        if(field){
+            double *dst = (double*)((char*)self + field->offset);
+
+            if(!parse_number(p, vend, dst))
+                *dst = NAN; /*null, string, ...*/
+            else if(field->ahrs && *dst == STRATUX_AHRS_INVALID)
+                *dst = NAN;
+            else
+                found++;
+        }
+
+        p = skip_spaces(vend, end);
+        if(p == end)
+            return -1;
+        if(*p == '}')
+            return found;
+        if(*p != ',')
+            return -1;
+        p = skip_spaces(p+1, end);
+    }
+    return -1;
+}
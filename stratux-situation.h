@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef STRATUX_SITUATION_H
+#define STRATUX_SITUATION_H
+#include <stdlib.h>
+
+/* Stratux reports invalid AHRS values as this*/
+#define STRATUX_AHRS_INVALID 3276.7
+
+/* The subset of /getSituation we use. Fields that are missing or
+ * invalid in the response are set to NAN*/
+typedef struct{
+    double gps_latitude;
+    double gps_longitude;
+    double gps_height_above_ellipsoid;
+    double gps_vertical_speed;
+    double baro_vertical_speed;
+    double ahrs_roll;
+    double ahrs_pitch;
+    double ahrs_gyro_heading;
+    double ahrs_mag_heading;
+}StratuxSituation;
+
+int stratux_situation_parse(StratuxSituation *self, const char *json, size_t len);
+#endif /* STRATUX_SITUATION_H */
@@ -0,0 +1,493 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+/*
+ * Post-flight analysis of FlightGear tapes: decodes a tape once into
+ * columns (one contiguous float array per signal), optionally saves them,
+ * and reports per-signal statistics, limits exceedances and engine
+ * trends over the whole flight.
+ *
+ * Usage: tape-analyze [-o flight.col] [-s step_ms] tape.fgtape|flight.col
+ *
+ * Columnar files (.col) are what -o writes: analyzing them again
+ * doesn't need the tape nor any decoding. Format, little-endian:
+ *   "SFCL", version (uint8), ncolumns (uint8), reserved (uint16),
+ *   nsamples (uint32), step (float32, s)
+ *   ncolumns times: name length (uint8), name (not NUL-terminated)
+ *   ncolumns times: nsamples float32
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "fg-tape.h"
+#include "fg-tape-data-source.h"
+
+#define COLUMNS_MAGIC "SFCL"
+#define COLUMNS_VERSION 1
+#define DEFAULT_STEP FG_TAPE_INDEX_STEP /*ms*/
+
+typedef enum{
+    COL_LATITUDE,
+    COL_LONGITUDE,
+    COL_ALTITUDE,
+    COL_ROLL,
+    COL_PITCH,
+    COL_HEADING,
+    COL_SLIP,
+    COL_AIRSPEED,
+    COL_VERTICAL_SPEED,
+    COL_RPM,
+    COL_FUEL_FLOW,
+    COL_OIL_TEMP,
+    COL_OIL_PRESS,
+    COL_CHT,
+    COL_FUEL_PX,
+    COL_FUEL_QTY,
+    COL_G_LOAD, /*Not part of TapeRecord, read on its own*/
+    N_COLUMNS
+}ColumnId;
+
+typedef struct{
+    const char *name;
+    const char *unit;
+    size_t offset; /*in TapeRecord*/
+    bool is_double;
+}ColumnDesc;
+
+#define RECORD_COLUMN(field, n, u) {n, u, offsetof(TapeRecord, field), sizeof(((TapeRecord*)0)->field) == sizeof(double)}
+static const ColumnDesc columns[N_COLUMNS] = {
+    [COL_LATITUDE] = RECORD_COLUMN(latitude, "latitude", "deg"),
+    [COL_LONGITUDE] = RECORD_COLUMN(longitude, "longitude", "deg"),
+    [COL_ALTITUDE] = RECORD_COLUMN(altitude, "altitude", "ft"),
+    [COL_ROLL] = RECORD_COLUMN(roll, "roll", "deg"),
+    [COL_PITCH] = RECORD_COLUMN(pitch, "pitch", "deg"),
+    [COL_HEADING] = RECORD_COLUMN(heading, "heading", "deg"),
+    [COL_SLIP] = RECORD_COLUMN(slip_rad, "slip", "rad"),
+    [COL_AIRSPEED] = RECORD_COLUMN(airspeed, "airspeed", "kt"),
+    [COL_VERTICAL_SPEED] = RECORD_COLUMN(vertical_speed, "vertical_speed", "ft/s"),
+    [COL_RPM] = RECORD_COLUMN(rpm, "rpm", "rpm"),
+    [COL_FUEL_FLOW] = RECORD_COLUMN(fuel_flow, "fuel_flow", "gph"),
+    [COL_OIL_TEMP] = RECORD_COLUMN(oil_temp, "oil_temp", "degF"),
+    [COL_OIL_PRESS] = RECORD_COLUMN(oil_press, "oil_press", "psi"),
+    [COL_CHT] = RECORD_COLUMN(cht, "cht", "degF"),
+    [COL_FUEL_PX] = RECORD_COLUMN(fuel_px, "fuel_px", "psi"),
+    [COL_FUEL_QTY] = RECORD_COLUMN(fuel_qty, "fuel_qty", "gal"),
+    [COL_G_LOAD] = {"g_load", "g", 0, false},
+};
+#define G_LOAD_SIGNAL "/accelerations[0]/pilot-g[0]"
+
+/* Limits checked over the whole flight, NAN when there is none.
+ * Defaults are the DR400/120 ones (the bundled tape), adjust for your
+ * aircraft*/
+static const struct{
+    ColumnId column;
+    float min, max;
+}limits[] = {
+    {COL_AIRSPEED, NAN, 166}, /*Vne*/
+    {COL_RPM, NAN, 2800},
+    {COL_OIL_TEMP, NAN, 245},
+    {COL_OIL_PRESS, 25, 100}, /*Only checked with the engine running*/
+    {COL_CHT, NAN, 500},
+    {COL_G_LOAD, -1.8, 3.8}, /*Normal category*/
+};
+#define ENGINE_RUNNING_RPM 500
+
+/*Engine parameters whose trend (per hour of flight) is reported*/
+static const ColumnId trends[] = {
+    COL_OIL_TEMP, COL_OIL_PRESS, COL_CHT, COL_FUEL_FLOW, COL_FUEL_PX
+};
+
+typedef struct{
+    uint32_t nsamples;
+    float step; /*s*/
+    float *data[N_COLUMNS]; /*NULL when the signal is missing*/
+}Columns;
+
+typedef struct{
+    float min, max, mean;
+    uint32_t imin, imax;
+    float slope; /*units per hour*/
+}ColumnStats;
+
+static bool columns_alloc(Columns *self, uint32_t nsamples)
+{
+    for(int i = 0; i < N_COLUMNS; i++){
+        if(!self->data[i])
+            continue;
+        self->data[i] = realloc(self->data[i], nsamples * sizeof(float));
+        if(!self->data[i])
+            return false;
+    }
+    return true;
+}
+
+static void columns_dispose(Columns *self)
+{
+    for(int i = 0; i < N_COLUMNS; i++)
+        free(self->data[i]);
+}
+
+/**
+ * @brief Decodes the tape, one sample every @p step ms, until its end.
+ */
+static bool columns_from_tape(Columns *self, const char *filename, uint32_t step)
+{
+    FGTape *tape;
+    FGTapeSignal signals[TAPE_RECORD_NSIGNALS];
+    FGTapeSignal g_signal;
+    TapeRecord record;
+    uint32_t allocated;
+    bool has_g;
+    float g;
+    int found;
+
+    tape = fg_tape_new_from_file(filename);
+    if(!tape){
+        printf("Couldn't load tape %s\n", filename);
+        return false;
+    }
+    found = fg_tape_get_signals(tape, signals, TAPE_RECORD_SIGNALS, NULL);
+    if(found != TAPE_RECORD_NSIGNALS)
+        printf("Warning: found %d out of %d signals\n", found, TAPE_RECORD_NSIGNALS);
+    has_g = fg_tape_get_signals(tape, &g_signal, G_LOAD_SIGNAL, NULL) == 1;
+    if(!has_g)
+        printf("Warning: no %s in the tape, G load won't be checked\n", G_LOAD_SIGNAL);
+
+    /*Non-NULL marks the columns to allocate*/
+    memset(self, 0, sizeof(Columns));
+    for(int i = 0; i < N_COLUMNS; i++)
+        self->data[i] = (i != COL_G_LOAD || has_g) ? malloc(sizeof(float)) : NULL;
+    self->step = step / 1000.0;
+
+    allocated = 0;
+    for(uint32_t n = 0; ; n++){
+        double t = n * self->step;
+
+        if(fg_tape_get_data_at(tape, t, TAPE_RECORD_NSIGNALS, signals, &record) <= 0)
+            break;
+        if(has_g && fg_tape_get_data_at(tape, t, 1, &g_signal, &g) <= 0)
+            g = NAN;
+
+        if(n == allocated){
+            allocated = allocated ? allocated * 2 : 4096;
+            if(!columns_alloc(self, allocated)){
+                printf("Couldn't allocate columns for %u samples\n", allocated);
+                fg_tape_free(tape);
+                return false;
+            }
+        }
+        /*Rows to columns*/
+        for(int i = 0; i < COL_G_LOAD; i++){
+            uint8_t *field = (uint8_t*)&record + columns[i].offset;
+            self->data[i][n] = columns[i].is_double ? *(double*)field : *(float*)field;
+        }
+        if(has_g)
+            self->data[COL_G_LOAD][n] = g;
+        self->nsamples = n + 1;
+    }
+    fg_tape_free(tape);
+    if(!self->nsamples){
+        printf("Empty tape %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static bool columns_save(Columns *self, const char *filename)
+{
+    FILE *fp;
+    uint8_t ncolumns, len;
+    bool rv;
+
+    fp = fopen(filename, "wb");
+    if(!fp){
+        printf("Couldn't open %s for writing\n", filename);
+        return false;
+    }
+    ncolumns = 0;
+    for(int i = 0; i < N_COLUMNS; i++)
+        ncolumns += self->data[i] != NULL;
+
+    fwrite(COLUMNS_MAGIC, 4, 1, fp);
+    fwrite(&(uint8_t){COLUMNS_VERSION}, 1, 1, fp);
+    fwrite(&ncolumns, 1, 1, fp);
+    fwrite(&(uint16_t){0}, 2, 1, fp);
+    fwrite(&self->nsamples, 4, 1, fp);
+    fwrite(&self->step, 4, 1, fp);
+    for(int i = 0; i < N_COLUMNS; i++){
+        if(!self->data[i])
+            continue;
+        len = strlen(columns[i].name);
+        fwrite(&len, 1, 1, fp);
+        fwrite(columns[i].name, len, 1, fp);
+    }
+    rv = true;
+    for(int i = 0; i < N_COLUMNS; i++){
+        if(self->data[i] && fwrite(self->data[i], sizeof(float), self->nsamples, fp) != self->nsamples)
+            rv = false;
+    }
+    if(fclose(fp) || !rv){
+        printf("Couldn't write %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static int column_by_name(const char *name)
+{
+    for(int i = 0; i < N_COLUMNS; i++){
+        if(!strcmp(columns[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Loads a file written by columns_save.
+ *
+ * @return true on success, false if @p filename isn't a columnar file or
+ * couldn't be read
+ */
+static bool columns_load(Columns *self, const char *filename)
+{
+    FILE *fp;
+    char magic[4];
+    uint8_t version, ncolumns, len;
+    uint16_t reserved;
+    char name[256];
+    int ids[256];
+    bool rv;
+
+    fp = fopen(filename, "rb");
+    if(!fp)
+        return false;
+    rv = fread(magic, 4, 1, fp) == 1 && !memcmp(magic, COLUMNS_MAGIC, 4)
+      && fread(&version, 1, 1, fp) == 1 && version == COLUMNS_VERSION
+      && fread(&ncolumns, 1, 1, fp) == 1
+      && fread(&reserved, 2, 1, fp) == 1
+      && fread(&self->nsamples, 4, 1, fp) == 1
+      && fread(&self->step, 4, 1, fp) == 1;
+    if(!rv){
+        fclose(fp);
+        return false;
+    }
+
+    memset(self->data, 0, sizeof(self->data));
+    for(int i = 0; i < ncolumns && rv; i++){
+        rv = fread(&len, 1, 1, fp) == 1 && fread(name, len, 1, fp) == 1;
+        name[len] = '\0';
+        ids[i] = column_by_name(name);
+        if(ids[i] >= 0)
+            self->data[ids[i]] = malloc(sizeof(float)); /*Mark*/
+        else
+            printf("Warning: unknown column %s, skipped\n", name);
+    }
+    rv = rv && columns_alloc(self, self->nsamples);
+    for(int i = 0; i < ncolumns && rv; i++){
+        if(ids[i] >= 0)
+            rv = fread(self->data[ids[i]], sizeof(float), self->nsamples, fp) == self->nsamples;
+        else
+            rv = !fseek(fp, self->nsamples * sizeof(float), SEEK_CUR);
+    }
+    fclose(fp);
+    if(!rv){
+        printf("Truncated or corrupted columnar file %s\n", filename);
+        columns_dispose(self);
+    }
+    return rv;
+}
+
+/**
+ * @brief Min, max, mean and linear trend of a column, in a single pass.
+ * Branchless reductions that the compiler can vectorize.
+ */
+static void column_stats(const float *restrict x, uint32_t n, float step, ColumnStats *st)
+{
+    float min = INFINITY, max = -INFINITY;
+    double sum = 0, sum_ix = 0;
+    double si, sii, den;
+
+#pragma omp simd reduction(min:min) reduction(max:max) reduction(+:sum,sum_ix)
+    for(uint32_t i = 0; i < n; i++){
+        min = fminf(min, x[i]);
+        max = fmaxf(max, x[i]);
+        sum += x[i];
+        sum_ix += (double)i * x[i];
+    }
+    st->min = min;
+    st->max = max;
+    st->mean = sum / n;
+
+    /*Least squares slope against the sample index, then per hour*/
+    si = (double)n * (n - 1) / 2;
+    sii = (double)(n - 1) * n * (2.0 * n - 1) / 6;
+    den = n * sii - si * si;
+    st->slope = (den > 0) ? (n * sum_ix - si * sum) / den / step * 3600.0 : 0;
+
+    /*Locating the extrema can't be vectorized along, it's a cheap second pass*/
+    st->imin = st->imax = 0;
+    for(uint32_t i = 0; i < n; i++){
+        if(x[i] == min){ st->imin = i; break; }
+    }
+    for(uint32_t i = 0; i < n; i++){
+        if(x[i] == max){ st->imax = i; break; }
+    }
+}
+
+static void print_time(float s)
+{
+    int ds = lroundf(s * 10); /*Rounded first, 59.96 must not print as 60.0*/
+
+    printf("%02d:%02d:%02d.%d", ds / 36000, ds / 600 % 60, ds / 10 % 60, ds % 10);
+}
+
+/**
+ * @brief Prints the intervals where @p x is out of [@p min, @p max].
+ *
+ * @param gate When not NULL, samples where gate[i] is false are ignored
+ * @return The number of intervals
+ */
+static int column_exceedances(Columns *cols, ColumnId id, float min, float max, const bool *gate)
+{
+    const float *x = cols->data[id];
+    uint32_t start = 0;
+    float peak = 0;
+    bool in = false;
+    int count = 0;
+
+    for(uint32_t i = 0; i <= cols->nsamples; i++){
+        bool out = i < cols->nsamples && (!gate || gate[i])
+                   && (x[i] < min || x[i] > max); /*NAN limits compare false*/
+        if(out && !in){
+            start = i;
+            peak = x[i];
+            in = true;
+        }else if(out){
+            peak = (x[i] > max) ? fmaxf(peak, x[i]) : fminf(peak, x[i]);
+        }else if(in){
+            printf("  %-15s ", columns[id].name);
+            print_time(start * cols->step);
+            printf(" for %6.1fs, peak %8.2f %s\n",
+                (i - start) * cols->step, peak, columns[id].unit
+            );
+            in = false;
+            count++;
+        }
+    }
+    return count;
+}
+
+static void columns_report(Columns *self)
+{
+    ColumnStats stats[N_COLUMNS];
+    bool *running;
+    int count;
+    double burnt;
+
+    printf("%u samples every %.0fms: ", self->nsamples, self->step * 1000);
+    print_time(self->nsamples * self->step);
+    printf(" of flight\n\n");
+
+    printf("%-15s %10s %10s %10s  %-6s %s\n", "signal", "min", "max", "mean", "unit", "max at");
+    for(int i = 0; i < N_COLUMNS; i++){
+        if(!self->data[i])
+            continue;
+        column_stats(self->data[i], self->nsamples, self->step, &stats[i]);
+        printf("%-15s %10.3f %10.3f %10.3f  %-6s ",
+            columns[i].name, stats[i].min, stats[i].max, stats[i].mean, columns[i].unit
+        );
+        print_time(stats[i].imax * self->step);
+        printf("\n");
+    }
+
+    printf("\nExceedances:\n");
+    running = malloc(self->nsamples * sizeof(bool));
+    if(running){
+        for(uint32_t i = 0; i < self->nsamples; i++)
+            running[i] = self->data[COL_RPM][i] > ENGINE_RUNNING_RPM;
+    }
+    count = 0;
+    for(int i = 0; i < sizeof(limits)/sizeof(limits[0]); i++){
+        if(!self->data[limits[i].column])
+            continue;
+        count += column_exceedances(self, limits[i].column, limits[i].min, limits[i].max,
+            (limits[i].column == COL_OIL_PRESS) ? running : NULL
+        );
+    }
+    if(!count)
+        printf("  none\n");
+    free(running);
+
+    printf("\nEngine trends (over the whole flight):\n");
+    for(int i = 0; i < sizeof(trends)/sizeof(trends[0]); i++){
+        ColumnId id = trends[i];
+        if(!self->data[id])
+            continue;
+        printf("  %-15s %+8.2f %s/h\n", columns[id].name, stats[id].slope, columns[id].unit);
+    }
+    if(self->data[COL_FUEL_FLOW] && self->data[COL_FUEL_QTY]){
+        burnt = stats[COL_FUEL_FLOW].mean * self->nsamples * self->step / 3600.0;
+        printf("  fuel burnt      %8.2f gal (fuel flow), %.2f gal (tank levels)\n",
+            burnt,
+            self->data[COL_FUEL_QTY][0] - self->data[COL_FUEL_QTY][self->nsamples-1]
+        );
+    }
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-o flight.col] [-s step_ms] tape.fgtape|flight.col\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    Columns cols;
+    const char *output = NULL;
+    uint32_t step = DEFAULT_STEP;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:s:h")) != -1){
+        switch(opt){
+            case 'o':
+                output = optarg;
+                break;
+            case 's':
+                step = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if(optind >= argc || !step){
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(!columns_load(&cols, argv[optind])
+       && !columns_from_tape(&cols, argv[optind], step))
+    {
+        exit(EXIT_FAILURE);
+    }
+    if(!cols.data[COL_RPM]){
+        printf("%s: no rpm column, not a flight\n", argv[optind]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(output && !columns_save(&cols, output))
+        exit(EXIT_FAILURE);
+    columns_report(&cols);
+    columns_dispose(&cols);
+
+    exit(EXIT_SUCCESS);
+}
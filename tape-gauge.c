@@ -16,6 +16,7 @@
 
 static void tape_gauge_update_state(TapeGauge *self, Uint32 dt);
 static BaseGaugeOps tape_gauge_ops = {
+   .name = "TapeGauge",
    .render = (RenderFunc)NULL,
    .update_state = (StateUpdateFunc)tape_gauge_update_state,
    .dispose = (DisposeFunc)NULL
@@ -24,6 +24,7 @@ static void text_gauge_update_state(TextGauge *self, Uint32 dt);
 static void text_gauge_render(TextGauge *self, Uint32 dt, RenderContext *ctx);
 static void *text_gauge_dispose(TextGauge *self);
 static BaseGaugeOps text_gauge_ops = {
+   .name = "TextGauge",
    .render = (RenderFunc)text_gauge_render,
    .update_state = (StateUpdateFunc)text_gauge_update_state,
    .dispose = (DisposeFunc)text_gauge_dispose
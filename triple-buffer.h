@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Single producer/single consumer, wait-free handoff of fixed size
+ * values: the producer fills the back slot and publishes it, the consumer
+ * picks up the most recent published slot. Neither side ever blocks and
+ * the consumer never sees a half-written value, it just skips the
+ * intermediate ones if it's slower than the producer.
+ *
+ * Slots are identified by their index (0-2), the shared word holds the
+ * index of the last published slot along with a "fresh" bit.
+ */
+#define TRIPLE_BUFFER_FRESH 0x4
+#define TRIPLE_BUFFER_INDEX 0x3
+
+typedef struct{
+    void *slots;
+    size_t size;
+
+    atomic_uint_fast8_t middle;
+    uint8_t back;   /*producer only*/
+    uint8_t front;  /*consumer only*/
+}TripleBuffer;
+
+static inline TripleBuffer *triple_buffer_init(TripleBuffer *self, size_t size)
+{
+    self->slots = calloc(3, size);
+    if(!self->slots)
+        return NULL;
+    self->size = size;
+    self->back = 0;
+    atomic_init(&self->middle, 1);
+    self->front = 2;
+    return self;
+}
+
+static inline TripleBuffer *triple_buffer_dispose(TripleBuffer *self)
+{
+    free(self->slots);
+    self->slots = NULL;
+    return self;
+}
+
+static inline void *triple_buffer_slot(TripleBuffer *self, uint8_t idx)
+{
+    return (uint8_t*)self->slots + idx * self->size;
+}
+
+/*Producer side: slot to fill before calling triple_buffer_publish*/
+static inline void *triple_buffer_back(TripleBuffer *self)
+{
+    return triple_buffer_slot(self, self->back);
+}
+
+static inline void triple_buffer_publish(TripleBuffer *self)
+{
+    uint_fast8_t old;
+
+    old = atomic_exchange_explicit(&self->middle,
+        self->back | TRIPLE_BUFFER_FRESH,
+        memory_order_acq_rel
+    );
+    self->back = old & TRIPLE_BUFFER_INDEX;
+}
+
+/**
+ * @brief Consumer side: gets the last published value.
+ *
+ * @return The freshly published slot or NULL if nothing has been
+ * published since the previous call. The slot stays valid (and untouched
+ * by the producer) until the next call.
+ */
+static inline void *triple_buffer_consume(TripleBuffer *self)
+{
+    uint_fast8_t old;
+
+    if(!(atomic_load_explicit(&self->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH))
+        return NULL;
+    old = atomic_exchange_explicit(&self->middle, self->front, memory_order_acq_rel);
+    self->front = old & TRIPLE_BUFFER_INDEX;
+    return triple_buffer_slot(self, self->front);
+}
+#endif /* TRIPLE_BUFFER_H */
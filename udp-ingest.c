@@ -0,0 +1,215 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /*recvmmsg*/
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "udp-ingest.h"
+
+/**
+ * @brief Binds a UDP socket on @p port, all interfaces.
+ *
+ * @param max_datagram Size of the biggest expected datagram, anything
+ * bigger will be discarded. 0 for UDP_INGEST_MTU.
+ */
+UdpIngest *udp_ingest_init(UdpIngest *self, int port, size_t max_datagram)
+{
+    return udp_ingest_init_group(self, NULL, port, max_datagram);
+}
+
+/**
+ * @brief Same as udp_ingest_init, also joining the multicast group
+ * @p group (on the default interface). Several receivers on the same host
+ * can join the same group and port.
+ *
+ * @param group Multicast address, e.g. "239.255.0.1". NULL for none.
+ */
+UdpIngest *udp_ingest_init_group(UdpIngest *self, const char *group, int port, size_t max_datagram)
+{
+    struct sockaddr_in addr = {0};
+    struct ip_mreq mreq = {0};
+    int one = 1;
+
+    *self = (UdpIngest){
+        .fd = -1,
+        .port = port,
+        .slot_size = max_datagram ? max_datagram : UDP_INGEST_MTU
+    };
+
+    self->slots = malloc(UDP_INGEST_SLOTS * self->slot_size);
+    self->msgs = calloc(UDP_INGEST_SLOTS, sizeof(struct mmsghdr));
+    if(!self->slots || !self->msgs)
+        return NULL;
+    for(int i = 0; i < UDP_INGEST_SLOTS; i++){
+        self->iovs[i].iov_base = self->slots + i * self->slot_size;
+        self->iovs[i].iov_len = self->slot_size;
+        self->msgs[i].msg_hdr.msg_iov = &self->iovs[i];
+        self->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    self->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(self->fd < 0){
+        printf("%s: couldn't create socket: %s\n", __FUNCTION__, strerror(errno));
+        return NULL;
+    }
+    if(group && setsockopt(self->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+        printf("%s: couldn't share port %d: %s\n", __FUNCTION__, port, strerror(errno));
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if(bind(self->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0){
+        printf("%s: couldn't bind port %d: %s\n", __FUNCTION__, port, strerror(errno));
+        return NULL;
+    }
+
+    if(group){
+        if(!inet_aton(group, &mreq.imr_multiaddr)){
+            printf("%s: %s is not a valid address\n", __FUNCTION__, group);
+            return NULL;
+        }
+        mreq.imr_interface.s_addr = INADDR_ANY;
+        if(setsockopt(self->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0){
+            printf("%s: couldn't join %s: %s\n", __FUNCTION__, group, strerror(errno));
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+UdpIngest *udp_ingest_dispose(UdpIngest *self)
+{
+    if(self->fd >= 0){
+        close(self->fd);
+        self->fd = -1;
+    }
+    free(self->slots);
+    free(self->msgs);
+    self->slots = NULL;
+    self->msgs = NULL;
+    return self;
+}
+
+/**
+ * @brief Reads what is queued on the socket, without blocking. At most
+ * UDP_INGEST_SLOTS datagrams are read per call, so that a flooding sender
+ * can't keep the caller in here: the rest is left queued on the socket for
+ * the next call, the kernel dropping what doesn't fit its buffer.
+ *
+ * @return The number of datagrams waiting to be handed out, -1 on
+ * socket error.
+ */
+int udp_ingest_drain(UdpIngest *self)
+{
+    int vlen, n;
+    int budget = UDP_INGEST_SLOTS;
+
+    while(budget > 0){
+        /*recvmmsg fills contiguous slots, stop at the end of the ring*/
+        vlen = UDP_INGEST_SLOTS - self->head;
+        if(vlen > budget)
+            vlen = budget;
+        n = recvmmsg(self->fd, self->msgs + self->head, vlen, MSG_DONTWAIT, NULL);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            printf("%s: port %d: %s\n", __FUNCTION__, self->port, strerror(errno));
+            return -1;
+        }
+
+        for(int i = self->head; i < self->head + n; i++){
+            if(self->msgs[i].msg_hdr.msg_flags & MSG_TRUNC){
+                self->stats.truncated++;
+                self->lens[i] = 0;
+            }else{
+                self->lens[i] = self->msgs[i].msg_len;
+            }
+        }
+        self->stats.received += n;
+        budget -= n;
+        self->head = (self->head + n) % UDP_INGEST_SLOTS;
+        self->pending += n;
+        if(self->pending > UDP_INGEST_SLOTS){
+            /*Wrapped over datagrams we didn't get a chance to hand out*/
+            self->stats.dropped += self->pending - UDP_INGEST_SLOTS;
+            self->pending = UDP_INGEST_SLOTS;
+        }
+        if(n < vlen) /*Socket is empty*/
+            break;
+    }
+
+    return self->pending;
+}
+
+/**
+ * @brief Hands out pending datagrams, oldest first. For protocols where
+ * each datagram only carries part of the state.
+ *
+ * @param len Set to the datagram size
+ * @return The datagram, valid until the next udp_ingest_drain, NULL when
+ * there is nothing left.
+ */
+const uint8_t *udp_ingest_next(UdpIngest *self, size_t *len)
+{
+    uint32_t idx;
+
+    while(self->pending){
+        idx = (self->head + UDP_INGEST_SLOTS - self->pending) % UDP_INGEST_SLOTS;
+        self->pending--;
+        if(self->lens[idx]){
+            *len = self->lens[idx];
+            return self->slots + idx * self->slot_size;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Hands out the most recent pending datagram, the older ones are
+ * discarded. For protocols where each datagram carries the whole state.
+ *
+ * @param len Set to the datagram size
+ * @return The datagram, valid until the next udp_ingest_drain, NULL when
+ * there is nothing new.
+ */
+const uint8_t *udp_ingest_latest(UdpIngest *self, size_t *len)
+{
+    const uint8_t *rv = NULL;
+    uint32_t idx;
+
+    for(; self->pending; self->pending--){
+        idx = (self->head + UDP_INGEST_SLOTS - self->pending) % UDP_INGEST_SLOTS;
+        if(!self->lens[idx])
+            continue;
+        if(rv)
+            self->stats.dropped++;
+        *len = self->lens[idx];
+        rv = self->slots + idx * self->slot_size;
+    }
+    return rv;
+}
+
+void udp_ingest_stats_print(UdpIngestStats *stats, const char *name)
+{
+    printf("%s: %llu datagrams received, %llu superseded, %llu truncated\n",
+        name,
+        (unsigned long long)stats->received,
+        (unsigned long long)stats->dropped,
+        (unsigned long long)stats->truncated
+    );
+}
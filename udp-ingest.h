@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef UDP_INGEST_H
+#define UDP_INGEST_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#define UDP_INGEST_SLOTS 16
+#define UDP_INGEST_MTU 1500 /*Default max datagram size*/
+
+typedef struct{
+    uint64_t received;
+    uint64_t dropped;   /*Superseded before having been handed out*/
+    uint64_t truncated; /*Bigger than a slot, discarded*/
+}UdpIngestStats;
+
+/* Non-blocking UDP receiver for simulators that stream their state:
+ * each drain reads at most a ring's worth of datagrams, a batch per
+ * syscall, into the ring. When the sender is faster than us, the oldest datagrams get
+ * overwritten, so that what is handed out is always the most recent.
+ */
+typedef struct{
+    int fd;
+    int port;
+
+    size_t slot_size;
+    uint8_t *slots;
+    size_t lens[UDP_INGEST_SLOTS];
+    struct mmsghdr *msgs; /*UDP_INGEST_SLOTS of them*/
+    struct iovec iovs[UDP_INGEST_SLOTS];
+
+    uint32_t head;      /*Next slot to be written*/
+    uint32_t pending;   /*Received, not handed out yet*/
+
+    UdpIngestStats stats;
+}UdpIngest;
+
+UdpIngest *udp_ingest_init(UdpIngest *self, int port, size_t max_datagram);
+UdpIngest *udp_ingest_init_group(UdpIngest *self, const char *group, int port, size_t max_datagram);
+UdpIngest *udp_ingest_dispose(UdpIngest *self);
+
+int udp_ingest_drain(UdpIngest *self);
+const uint8_t *udp_ingest_next(UdpIngest *self, size_t *len);
+const uint8_t *udp_ingest_latest(UdpIngest *self, size_t *len);
+
+void udp_ingest_stats_print(UdpIngestStats *stats, const char *name);
+#endif /* UDP_INGEST_H */
@@ -22,6 +22,7 @@ static void vertical_stair_render(VerticalStair *self, Uint32 dt, RenderContext
 static void vertical_stair_update_state(VerticalStair *self, Uint32 dt);
 static void *vertical_stair_dispose(VerticalStair *self);
 static BaseGaugeOps vertical_stair_ops = {
+   .name = "VerticalStair",
    .render = (RenderFunc)vertical_stair_render,
    .update_state = (StateUpdateFunc)vertical_stair_update_state,
    .dispose = (DisposeFunc)vertical_stair_dispose
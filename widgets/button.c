@@ -20,6 +20,7 @@ static Button *button_dispose(Button *self);
 static bool button_handle_event(Button *self, SDL_KeyboardEvent *event);
 
 static BaseWidgetOps button_ops ={
+    .super.name = "Button",
     .super.update_state = (StateUpdateFunc)button_update,
     .super.render = (RenderFunc)button_render,
     .super.dispose = (DisposeFunc)button_dispose,
@@ -26,6 +26,7 @@ static void list_box_render(ListBox *self, Uint32 dt, RenderContext *ctx);
 static ListBox *list_box_dispose(ListBox *self);
 static bool list_box_handle_event(ListBox *self, SDL_KeyboardEvent *event);
 static BaseWidgetOps list_box_ops = {
+    .super.name = "ListBox",
     .super.render = (RenderFunc)list_box_render,
     .super.update_state = (StateUpdateFunc)list_box_update,
     .super.dispose = (DisposeFunc)list_box_dispose,
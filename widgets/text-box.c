@@ -30,6 +30,7 @@ static TextBox *text_box_dispose(TextBox *self);
 static bool text_box_handle_event(TextBox *self, SDL_KeyboardEvent *event);
 
 static BaseWidgetOps text_box_ops ={
+    .super.name = "TextBox",
     .super.render = (RenderFunc)text_box_render,
     .super.update_state = (StateUpdateFunc)text_box_update,
     .super.dispose = (DisposeFunc)text_box_dispose,
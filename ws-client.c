@@ -0,0 +1,359 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "misc.h"
+#include "ws-client.h"
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT 0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+#define WS_READ_CHUNK 4096
+
+static bool ws_client_reserve(uint8_t **buf, size_t *allocated, size_t size);
+static bool ws_client_send_control(WsClient *self, uint8_t opcode, const uint8_t *payload, size_t len);
+static void base64_encode(const uint8_t *src, size_t len, char *dst);
+
+WsClient *ws_client_init(WsClient *self)
+{
+    *self = (WsClient){
+        .fd = -1
+    };
+    return self;
+}
+
+WsClient *ws_client_dispose(WsClient *self)
+{
+    ws_client_close(self);
+    free(self->buf);
+    free(self->frag);
+    return self;
+}
+
+/**
+ * @brief Opens the TCP connection and performs the WebSocket handshake.
+ * Blocking, to be called from a background thread.
+ *
+ * @param path Resource to ask for, i.e "/situation"
+ * @param timeout Connection and handshake timeout, ms
+ * @return true on success, false otherwise
+ */
+bool ws_client_connect(WsClient *self, const char *host, int port, const char *path, int timeout)
+{
+    struct addrinfo hints = {0}, *res, *ai;
+    struct timeval tv;
+    char portstr[8];
+    char request[512];
+    char key[25];
+    uint8_t nonce[16];
+    uint64_t seed;
+    char *eoh;
+    int err;
+
+    ws_client_close(self);
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(portstr, sizeof(portstr), "%d", port);
+    err = getaddrinfo(host, portstr, &hints, &res);
+    if(err){
+        printf("%s: couldn't resolve %s: %s\n", __FUNCTION__, host, gai_strerror(err));
+        return false;
+    }
+
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    for(ai = res; ai; ai = ai->ai_next){
+        self->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(self->fd < 0)
+            continue;
+        /*Bounds connect() too*/
+        setsockopt(self->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(self->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if(connect(self->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(self->fd);
+        self->fd = -1;
+    }
+    freeaddrinfo(res);
+    if(self->fd < 0)
+        return false;
+
+    /*The key only has to be unique per connection, not secret*/
+    seed = monotonic_ns();
+    for(int i = 0; i < sizeof(nonce); i++){
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        nonce[i] = seed >> 56;
+    }
+    base64_encode(nonce, sizeof(nonce), key);
+
+    snprintf(request, sizeof(request),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s:%d\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: %s\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n",
+        path, host, port, key
+    );
+    if(send(self->fd, request, strlen(request), MSG_NOSIGNAL) < 0)
+        goto fail;
+
+    /*Read up to the end of the response headers, frames may follow*/
+    self->len = self->consumed = 0;
+    do{
+        ssize_t n;
+
+        if(!ws_client_reserve(&self->buf, &self->allocated, self->len + WS_READ_CHUNK + 1))
+            goto fail;
+        n = recv(self->fd, self->buf + self->len, WS_READ_CHUNK, 0);
+        if(n <= 0)
+            goto fail;
+        self->len += n;
+        self->buf[self->len] = '\0';
+        eoh = strstr((char*)self->buf, "\r\n\r\n");
+    }while(!eoh && self->len < 8192);
+
+    if(!eoh || strncmp((char*)self->buf, "HTTP/1.1 101", 12)){
+        printf("%s: %s:%d%s refused the upgrade\n", __FUNCTION__, host, port, path);
+        goto fail;
+    }
+    self->consumed = eoh + 4 - (char*)self->buf;
+    self->frag_len = 0;
+    self->frag_done = false;
+    return true;
+
+fail:
+    ws_client_close(self);
+    return false;
+}
+
+void ws_client_close(WsClient *self)
+{
+    if(self->fd >= 0){
+        close(self->fd);
+        self->fd = -1;
+    }
+    self->len = self->consumed = 0;
+    self->frag_len = 0;
+}
+
+/**
+ * @brief Waits for the next data message, answering pings along the way.
+ *
+ * @param payload Set to the message, valid until the next call. Not
+ * NULL-terminated.
+ * @param len Set to the message length
+ * @param timeout Maximum time to wait, ms
+ * @return WS_MESSAGE when @p payload has been set, WS_TIMEOUT if nothing
+ * came in time, WS_CLOSED if the connection is gone (the client is then
+ * closed and can be reconnected).
+ */
+WsResult ws_client_recv(WsClient *self, const char **payload, size_t *len, int timeout)
+{
+    uint64_t deadline;
+
+    if(self->fd < 0)
+        return WS_CLOSED;
+
+    if(self->frag_done){
+        self->frag_len = 0;
+        self->frag_done = false;
+    }
+    deadline = monotonic_ns() + timeout * 1000000ULL;
+    while(true){
+        uint8_t *p;
+        size_t avail, hdr;
+        uint64_t plen;
+        uint8_t opcode;
+        bool fin;
+
+        if(self->consumed){
+            memmove(self->buf, self->buf + self->consumed, self->len - self->consumed);
+            self->len -= self->consumed;
+            self->consumed = 0;
+        }
+
+        /* Frame header: 2 bytes, then 0, 2 or 8 bytes of extended
+         * length, then the mask if any*/
+        p = self->buf;
+        avail = self->len;
+        hdr = SIZE_MAX; /*Unknown yet*/
+        plen = 0;
+        if(avail >= 2){
+            size_t ext;
+
+            plen = p[1] & 0x7F;
+            ext = (plen == 126) ? 2 : (plen == 127) ? 8 : 0;
+            if(avail >= 2 + ext){
+                if(ext){
+                    plen = 0;
+                    for(int i = 2; i < 2 + ext; i++)
+                        plen = (plen << 8) | p[i];
+                }
+                /*Servers aren't supposed to mask, but tolerate it*/
+                hdr = 2 + ext + ((p[1] & 0x80) ? 4 : 0);
+            }
+            if(plen > WS_MAX_MESSAGE){
+                printf("%s: %llu bytes frame, closing\n", __FUNCTION__, (unsigned long long)plen);
+                ws_client_close(self);
+                return WS_CLOSED;
+            }
+        }
+
+        if(hdr != SIZE_MAX && avail >= hdr && avail - hdr >= plen){
+            uint8_t *data = p + hdr;
+
+            fin = p[0] & 0x80;
+            opcode = p[0] & 0x0F;
+            if(p[1] & 0x80){
+                uint8_t *mask = data - 4;
+                for(uint64_t i = 0; i < plen; i++)
+                    data[i] ^= mask[i % 4];
+            }
+            self->consumed = hdr + plen;
+
+            switch(opcode){
+                case WS_OP_TEXT:
+                case WS_OP_BINARY:
+                case WS_OP_CONTINUATION:
+                    if(fin && opcode != WS_OP_CONTINUATION && !self->frag_len){
+                        *payload = (const char*)data;
+                        *len = plen;
+                        return WS_MESSAGE;
+                    }
+                    if(self->frag_len + plen > WS_MAX_MESSAGE
+                       || !ws_client_reserve(&self->frag, &self->frag_allocated, self->frag_len + plen)){
+                        ws_client_close(self);
+                        return WS_CLOSED;
+                    }
+                    memcpy(self->frag + self->frag_len, data, plen);
+                    self->frag_len += plen;
+                    if(fin){
+                        self->frag_done = true;
+                        *payload = (const char*)self->frag;
+                        *len = self->frag_len;
+                        return WS_MESSAGE;
+                    }
+                    break;
+                case WS_OP_CLOSE:
+                    ws_client_send_control(self, WS_OP_CLOSE, data, plen > 125 ? 0 : plen);
+                    ws_client_close(self);
+                    return WS_CLOSED;
+                case WS_OP_PING:
+                    ws_client_send_control(self, WS_OP_PONG, data, plen > 125 ? 125 : plen);
+                    break;
+                default: /*pong, reserved*/
+                    break;
+            }
+            continue;
+        }
+
+        /*Need more bytes*/
+        uint64_t now = monotonic_ns();
+        struct pollfd pfd = {.fd = self->fd, .events = POLLIN};
+        ssize_t n;
+        int rv;
+
+        if(now >= deadline)
+            return WS_TIMEOUT;
+        rv = poll(&pfd, 1, (deadline - now) / 1000000 + 1);
+        if(rv == 0)
+            return WS_TIMEOUT;
+        if(rv < 0){
+            if(errno == EINTR)
+                continue;
+            ws_client_close(self);
+            return WS_CLOSED;
+        }
+        if(!ws_client_reserve(&self->buf, &self->allocated,
+                              self->len + (hdr != SIZE_MAX && hdr + plen > WS_READ_CHUNK ? hdr + plen : WS_READ_CHUNK))){
+            ws_client_close(self);
+            return WS_CLOSED;
+        }
+        n = recv(self->fd, self->buf + self->len, self->allocated - self->len, MSG_DONTWAIT);
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            continue;
+        if(n <= 0){
+            ws_client_close(self);
+            return WS_CLOSED;
+        }
+        self->len += n;
+    }
+}
+
+static bool ws_client_reserve(uint8_t **buf, size_t *allocated, size_t size)
+{
+    void *tmp;
+
+    if(*allocated >= size)
+        return true;
+    tmp = realloc(*buf, size);
+    if(!tmp)
+        return false;
+    *buf = tmp;
+    *allocated = size;
+    return true;
+}
+
+/*Client frames must be masked, control payloads are at most 125 bytes*/
+static bool ws_client_send_control(WsClient *self, uint8_t opcode, const uint8_t *payload, size_t len)
+{
+    uint8_t frame[2 + 4 + 125];
+    uint8_t *mask = frame + 2;
+    uint64_t seed;
+
+    seed = monotonic_ns() * 6364136223846793005ULL;
+    frame[0] = 0x80 | opcode;
+    frame[1] = 0x80 | len;
+    for(int i = 0; i < 4; i++)
+        mask[i] = seed >> (56 - 8*i);
+    for(size_t i = 0; i < len; i++)
+        frame[6 + i] = payload[i] ^ mask[i % 4];
+
+    return send(self->fd, frame, 6 + len, MSG_NOSIGNAL) == 6 + len;
+}
+
+/*@p dst must hold 4*ceil(len/3)+1 chars*/
+static void base64_encode(const uint8_t *src, size_t len, char *dst)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t i;
+
+    for(i = 0; i + 2 < len; i += 3){
+        *dst++ = alphabet[src[i] >> 2];
+        *dst++ = alphabet[((src[i] & 0x03) << 4) | (src[i+1] >> 4)];
+        *dst++ = alphabet[((src[i+1] & 0x0F) << 2) | (src[i+2] >> 6)];
+        *dst++ = alphabet[src[i+2] & 0x3F];
+    }
+    if(i < len){
+        *dst++ = alphabet[src[i] >> 2];
+        if(i + 1 < len){
+            *dst++ = alphabet[((src[i] & 0x03) << 4) | (src[i+1] >> 4)];
+            *dst++ = alphabet[(src[i+1] & 0x0F) << 2];
+        }else{
+            *dst++ = alphabet[(src[i] & 0x03) << 4];
+            *dst++ = '=';
+        }
+        *dst++ = '=';
+    }
+    *dst = '\0';
+}
@@ -0,0 +1,52 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Samuel Cuella <samuel.cuella@gmail.com>
+ *
+ * This file is part of SoFIS - an open source EFIS
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+#ifndef WS_CLIENT_H
+#define WS_CLIENT_H
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WS_MAX_MESSAGE (1024*1024) /*Anything bigger is a protocol error*/
+
+typedef enum{
+    WS_MESSAGE,
+    WS_TIMEOUT,
+    WS_CLOSED   /*Connection closed or lost, needs to reconnect*/
+}WsResult;
+
+/* Minimal WebSocket (RFC 6455) client, enough to consume the push streams
+ * of devices on the local network: no TLS, no extensions. Incoming
+ * messages are handed out straight from the receive buffer.
+ */
+typedef struct{
+    int fd;
+
+    uint8_t *buf;       /*Raw bytes read from the socket*/
+    size_t len;
+    size_t allocated;
+    size_t consumed;    /*Bytes already handed out, dropped on next call*/
+
+    /*Fragmented message being reassembled*/
+    uint8_t *frag;
+    size_t frag_len;
+    size_t frag_allocated;
+    bool frag_done;
+}WsClient;
+
+WsClient *ws_client_init(WsClient *self);
+WsClient *ws_client_dispose(WsClient *self);
+
+bool ws_client_connect(WsClient *self, const char *host, int port, const char *path, int timeout);
+void ws_client_close(WsClient *self);
+WsResult ws_client_recv(WsClient *self, const char **payload, size_t *len, int timeout);
+
+static inline bool ws_client_connected(WsClient *self)
+{
+    return self->fd >= 0;
+}
+#endif /* WS_CLIENT_H */
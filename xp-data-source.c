@@ -7,77 +7,113 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <string.h>
+#include <netdb.h>
 #include <arpa/inet.h>
 
 #include "data-source.h"
 #include "xp-data-source.h"
 
-// Lookup table for row IDs and their corresponding parsers
-typedef void (*RowParser)(float values[]);
-RowParser lookup_table[100] = {NULL};  // Supports row IDs up to 54
-
-// Initialize structs
-Attitude attitude = {0};
-Position position = {0};
-Airspeed airspeed = {0};
-Engine engine = {0};
-
-// Row parsers
-void parse_attitude(float values[]) {
-    attitude.pitch = values[0];
-    attitude.roll = values[1];
-    attitude.heading = values[3];
-}
-void parse_position(float values[]) {
-    position.latitude = values[0];
-    position.longitude = values[1];
-    position.altitude = values[2];
-}
-void parse_airspeeds(float values[]) {
-    airspeed.indicated_airspeed = values[0];
-    airspeed.true_airspeed = values[2];
-    airspeed.groundspeed = values[3];    
-}
-void parse_sideslip(float values[]){attitude.sideslip = values[7];}
-void parse_rpm(float values[]) {    engine.rpm = values[0];}
-void parse_fuelflow(float values[]) {    engine.fuelflow = values[0];}
-void parse_egt(float values[]) {    engine.egt = values[0];}
-void parse_cht(float values[]) {   engine.cht = values[0];}
-void parse_oil_press(float values[]) {  engine.oil_press = values[0]; }
-void parse_oil_temp(float values[]) { engine.oil_temp = values[0];  }
-void parse_man_press(float values[]) { engine.man_press = values[0];  }
-void parse_fuel_press(float values[]) { engine.fuel_press = values[0];  }
-void parse_volts(float values[]) { engine.battery_volts = values[0];  }
-void parse_vvi(float values[]) {airspeed.vertical = values[2];}
-void parse_fuel_quantity(float values[])
-{
-    for (int i=3; i >= 0 ; i--)
-        engine.fuelQuantity[i] = values[i];
-}
-
-// Initialize lookup table
-void initialize_lookup_table() {
-    lookup_table[3] = (RowParser)parse_airspeeds;  // Attitude
-    lookup_table[4] = (RowParser)parse_vvi;
-    lookup_table[17] = (RowParser)parse_attitude;  // Attitude
-    lookup_table[18] = (RowParser)parse_sideslip;  
-    lookup_table[20] = (RowParser)parse_position; // Position
-    lookup_table[37] = (RowParser)parse_rpm;  
-    lookup_table[43] = (RowParser)parse_man_press;  
-    lookup_table[45] = (RowParser)parse_fuelflow;  
-    lookup_table[47] = (RowParser)parse_egt;  
-    lookup_table[48] = (RowParser)parse_cht;
-    lookup_table[49] = (RowParser)parse_oil_press;
-    lookup_table[50] = (RowParser)parse_oil_temp;
-    lookup_table[51] = (RowParser)parse_fuel_press;
-    lookup_table[54] = (RowParser)parse_volts;
-    lookup_table[62] = (RowParser)parse_fuel_quantity;
-    // Add other row IDs and their handlers as needed
-}
+#define BUFFER_SIZE 1024
 
+/* X-Plane packets: a 5 bytes header ("DATA*", "RREF,") followed by
+ * fixed size records:
+ * DATA: int32 row id, 8 floats
+ * RREF: int32 subscription index, 1 float
+ * Everything is little-endian*/
+#define XP_HEADER_SIZE 5
+#define XP_DATA_ROW_SIZE 36
+#define XP_RREF_ROW_SIZE 8
+#define XP_RREF_REQUEST_SIZE 413 /*header, freq, index, 400 chars path*/
+
+#define M_TO_FEET 3.28084
+#define MS_TO_KNOTS 1.943844
+#define AVGAS_KG_TO_GAL 0.366906 /*0.72 kg/l*/
+#define AVGAS_LB_TO_GAL (0.453592 * AVGAS_KG_TO_GAL)
+
+/* DATA rows: which values of which row go where, converted to the
+ * same units as the RREF path. value = raw * scale + bias*/
+typedef struct{
+    uint8_t index;   /*Position in the row, 0-7*/
+    uint16_t offset; /*Destination in XPState*/
+    float scale;
+    float bias;
+}XPDataField;
+
+typedef struct{
+    uint8_t nfields;
+    XPDataField fields[4];
+}XPDataRow;
+
+#define XP_FIELD(i, f) XP_FIELD_SCALED(i, f, 1, 0)
+#define XP_FIELD_SCALED(i, f, s, b) {.index = (i), .offset = offsetof(XPState, f), .scale = (s), .bias = (b)}
+static const XPDataRow xp_data_rows[] = {
+    [3] = {3, {XP_FIELD(0, indicated_airspeed), XP_FIELD(2, true_airspeed), XP_FIELD(3, groundspeed)}},
+    [4] = {1, {XP_FIELD(2, vertical_speed)}},
+    [17] = {3, {XP_FIELD(0, pitch), XP_FIELD(1, roll), XP_FIELD(3, heading)}},
+    [18] = {1, {XP_FIELD(7, sideslip)}},
+    [20] = {3, {XP_FIELD(0, latitude), XP_FIELD(1, longitude), XP_FIELD(2, altitude)}},
+    [37] = {1, {XP_FIELD(0, rpm)}},
+    [43] = {1, {XP_FIELD(0, man_press)}},
+    [45] = {1, {XP_FIELD(0, fuel_flow)}},
+    [47] = {1, {XP_FIELD(0, egt)}},
+    [48] = {1, {XP_FIELD(0, cht)}},
+    [49] = {1, {XP_FIELD(0, oil_press)}},
+    [50] = {1, {XP_FIELD(0, oil_temp)}},
+    [51] = {1, {XP_FIELD(0, fuel_press)}},
+    [54] = {1, {XP_FIELD(0, battery_volts)}},
+    [62] = {4, { /*lb*/
+        XP_FIELD_SCALED(0, fuel_qty[0], AVGAS_LB_TO_GAL, 0),
+        XP_FIELD_SCALED(1, fuel_qty[1], AVGAS_LB_TO_GAL, 0),
+        XP_FIELD_SCALED(2, fuel_qty[2], AVGAS_LB_TO_GAL, 0),
+        XP_FIELD_SCALED(3, fuel_qty[3], AVGAS_LB_TO_GAL, 0)
+    }},
+};
+#define XP_DATA_ROWS (sizeof(xp_data_rows)/sizeof(xp_data_rows[0]))
+
+/* RREF subscriptions, the position in the table is the index X-Plane
+ * will send back with the values. value = raw * scale + bias*/
+typedef struct{
+    const char *path;
+    uint16_t offset;
+    float scale;
+    float bias;
+}XPDataRef;
+
+#define XP_DATAREF(p, f, s, b) {.path = (p), .offset = offsetof(XPState, f), .scale = (s), .bias = (b)}
+static const XPDataRef xp_datarefs[] = {
+    XP_DATAREF("sim/flightmodel/position/theta", pitch, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/phi", roll, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/mag_psi", heading, 1, 0),
+    XP_DATAREF("sim/cockpit2/gauges/indicators/slip_deg", sideslip, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/latitude", latitude, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/longitude", longitude, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/elevation", altitude, M_TO_FEET, 0),
+    XP_DATAREF("sim/flightmodel/position/indicated_airspeed", indicated_airspeed, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/true_airspeed", true_airspeed, MS_TO_KNOTS, 0),
+    XP_DATAREF("sim/flightmodel/position/vh_ind_fpm", vertical_speed, 1, 0),
+    XP_DATAREF("sim/flightmodel/position/groundspeed", groundspeed, MS_TO_KNOTS, 0),
+    XP_DATAREF("sim/cockpit2/engine/indicators/engine_speed_rpm[0]", rpm, 1, 0),
+    XP_DATAREF("sim/cockpit2/engine/indicators/oil_pressure_psi[0]", oil_press, 1, 0),
+    XP_DATAREF("sim/cockpit2/engine/indicators/oil_temperature_deg_C[0]", oil_temp, 1.8, 32),
+    XP_DATAREF("sim/cockpit2/engine/indicators/EGT_deg_C[0]", egt, 1.8, 32),
+    XP_DATAREF("sim/cockpit2/engine/indicators/CHT_deg_C[0]", cht, 1.8, 32),
+    XP_DATAREF("sim/cockpit2/engine/indicators/MPR_in_hg[0]", man_press, 1, 0),
+    XP_DATAREF("sim/cockpit2/engine/indicators/fuel_flow_kg_sec[0]", fuel_flow, AVGAS_KG_TO_GAL * 3600, 0),
+    XP_DATAREF("sim/cockpit2/engine/indicators/fuel_pressure_psi[0]", fuel_press, 1, 0),
+    XP_DATAREF("sim/cockpit2/fuel/fuel_quantity[0]", fuel_qty[0], AVGAS_KG_TO_GAL, 0),
+    XP_DATAREF("sim/cockpit2/fuel/fuel_quantity[1]", fuel_qty[1], AVGAS_KG_TO_GAL, 0),
+    XP_DATAREF("sim/cockpit2/electrical/battery_voltage_actual_volts[0]", battery_volts, 1, 0),
+};
+#define XP_DATAREFS (sizeof(xp_datarefs)/sizeof(xp_datarefs[0]))
 
+static inline float *xp_state_field(XPState *state, uint16_t offset)
+{
+    return (float*)((uint8_t*)state + offset);
+}
 
 static bool xp_data_source_frame(XPDataSource *self, uint32_t dt);
 static XPDataSource *xp_data_source_dispose(XPDataSource *self);
@@ -86,7 +122,7 @@ static DataSourceOps xp_data_source_ops = {
     .dispose = (DataSourceDisposeFunc)xp_data_source_dispose
 };
 
-XPDataSource *xp_data_source_new2(int port)
+XPDataSource *xp_data_source_new(int port)
 {
     XPDataSource *self;
 
@@ -101,38 +137,24 @@ XPDataSource *xp_data_source_new2(int port)
     return self;
 }
 
-int sockfd;
-struct sockaddr_in server_addr, client_addr;
-socklen_t addr_len = sizeof(client_addr);
-#define XP_SERVER_PORT 49000         // Port that X-Plane sends data to
-#define BUFFER_SIZE 1024
-
+/**
+ * @brief Listens for X-Plane packets on @p port. Either DATA rows
+ * (X-Plane's "Data Output" screen, "Send network data output") or RREF
+ * answers, see xp_data_source_subscribe.
+ */
 XPDataSource *xp_data_source_init(XPDataSource *self, int port)
 {
     if(!data_source_init(DATA_SOURCE(self), &xp_data_source_ops))
         return NULL;
 
-    initialize_lookup_table();
-
     self->port = port;
-
-    // Create the socket
-    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("Socket creation failed");
-        return self;
-    }
-
-    // Configure server address
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
-
-    // Bind the socket to the port
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("Bind failed");
-        close(sockfd);
-        return self;
+    /*Shown as unknown until X-Plane sends them*/
+    self->state.egt = NAN;
+    self->state.man_press = NAN;
+    self->state.battery_volts = NAN;
+    if(!udp_ingest_init(&self->ingest, port, BUFFER_SIZE)){
+        udp_ingest_dispose(&self->ingest);
+        return NULL;
     }
 
     printf("Server is listening on port %d...\n", port);
@@ -142,92 +164,186 @@ XPDataSource *xp_data_source_init(XPDataSource *self, int port)
 
 static XPDataSource *xp_data_source_dispose(XPDataSource *self)
 {
-    close(sockfd);
-    sockfd = -1;
+    xp_data_source_unsubscribe(self);
+    if(self->ingest.stats.received)
+        udp_ingest_stats_print(&self->ingest.stats, "XPDataSource");
+    if(self->unsupported)
+        printf("XPDataSource: %llu unsupported DATA rows ignored\n", (unsigned long long)self->unsupported);
+    udp_ingest_dispose(&self->ingest);
     return self;
 }
 
+static bool xp_data_source_send_rref(XPDataSource *self, int rate, int32_t index)
+{
+    uint8_t msg[XP_RREF_REQUEST_SIZE] = "RREF";
+    int32_t freq = rate;
+
+    memcpy(msg + XP_HEADER_SIZE, &freq, sizeof(int32_t));
+    memcpy(msg + XP_HEADER_SIZE + 4, &index, sizeof(int32_t));
+    strncpy((char*)msg + XP_HEADER_SIZE + 8, xp_datarefs[index].path, XP_RREF_REQUEST_SIZE - XP_HEADER_SIZE - 8 - 1);
+
+    return sendto(self->ingest.fd, msg, sizeof(msg), 0,
+        (struct sockaddr *)&self->sim, sizeof(self->sim)) == sizeof(msg);
+}
+
+/**
+ * @brief Asks X-Plane to stream the datarefs we need, instead of relying
+ * on the Data Output settings. Answers come back to our port.
+ *
+ * @param host X-Plane address, with an optional port (default XP_SIM_PORT)
+ * @param rate Updates per second
+ * @return true on success, false otherwise
+ */
+bool xp_data_source_subscribe(XPDataSource *self, const char *host, int rate)
+{
+    struct addrinfo hints = {0}, *res;
+    char name[64];
+    char defport[8];
+    char *port;
+    int err;
+
+    snprintf(name, sizeof(name), "%s", host);
+    port = strchr(name, ':');
+    if(port)
+        *port++ = '\0';
+
+    snprintf(defport, sizeof(defport), "%d", XP_SIM_PORT);
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    err = getaddrinfo(name, port ? port : defport, &hints, &res);
+    if(err){
+        printf("%s: couldn't resolve %s: %s\n", __FUNCTION__, name, gai_strerror(err));
+        return false;
+    }
+    memcpy(&self->sim, res->ai_addr, sizeof(self->sim));
+    freeaddrinfo(res);
+
+    for(int i = 0; i < XP_DATAREFS; i++){
+        if(!xp_data_source_send_rref(self, rate, i)){
+            printf("%s: couldn't subscribe to %s\n", __FUNCTION__, xp_datarefs[i].path);
+            return false;
+        }
+    }
+    self->subscribed = true;
+    return true;
+}
+
+void xp_data_source_unsubscribe(XPDataSource *self)
+{
+    if(!self->subscribed)
+        return;
+    /*Rate 0 stops the stream*/
+    for(int i = 0; i < XP_DATAREFS; i++)
+        xp_data_source_send_rref(self, 0, i);
+    self->subscribed = false;
+}
+
+static void xp_data_source_decode_data(XPDataSource *self, const uint8_t *buffer, size_t len)
+{
+    const uint8_t *row;
+    const XPDataRow *desc;
+    int32_t row_id;
+    float values[8];
+
+    for(row = buffer + XP_HEADER_SIZE; row + XP_DATA_ROW_SIZE <= buffer + len; row += XP_DATA_ROW_SIZE){
+        memcpy(&row_id, row, sizeof(int32_t));
+        if(row_id < 0 || row_id >= XP_DATA_ROWS || !xp_data_rows[row_id].nfields){
+            self->unsupported++;
+            continue;
+        }
+        memcpy(values, row + 4, sizeof(values));
+
+        desc = &xp_data_rows[row_id];
+        for(int i = 0; i < desc->nfields; i++)
+            *xp_state_field(&self->state, desc->fields[i].offset) =
+                values[desc->fields[i].index] * desc->fields[i].scale + desc->fields[i].bias;
+    }
+}
+
+static void xp_data_source_decode_rref(XPDataSource *self, const uint8_t *buffer, size_t len)
+{
+    const uint8_t *row;
+    const XPDataRef *ref;
+    int32_t index;
+    float value;
+
+    for(row = buffer + XP_HEADER_SIZE; row + XP_RREF_ROW_SIZE <= buffer + len; row += XP_RREF_ROW_SIZE){
+        memcpy(&index, row, sizeof(int32_t));
+        memcpy(&value, row + 4, sizeof(float));
+        if(index < 0 || index >= XP_DATAREFS)
+            continue;
+        ref = &xp_datarefs[index];
+        *xp_state_field(&self->state, ref->offset) = value * ref->scale + ref->bias;
+    }
+}
+
 static bool xp_data_source_frame(XPDataSource *self, uint32_t dt)
 {
-    char buffer[BUFFER_SIZE];
+    const uint8_t *buffer;
+    size_t len;
+    bool rv = false;
+
+    if(udp_ingest_drain(&self->ingest) <= 0)
+        return false;
+
+    /* Rows are spread over datagrams depending on X-Plane's settings: go
+     * through everything that came in since last time, and publish the
+     * resulting state once*/
+    while((buffer = udp_ingest_next(&self->ingest, &len))){
+        if(len < XP_HEADER_SIZE)
+            continue;
+        if(!memcmp(buffer, "DATA", 4)){
+            xp_data_source_decode_data(self, buffer, len);
+            rv = true;
+        }else if(!memcmp(buffer, "RREF", 4)){
+            xp_data_source_decode_rref(self, buffer, len);
+            rv = true;
+        }
+    }
+    if(!rv)
+        return false;
+
+    data_source_set_location(
+        DATA_SOURCE(self), &(LocationData){
+            .super.latitude = self->state.latitude,
+            .super.longitude = self->state.longitude,
+            .altitude = self->state.altitude
+        }
+    );
 
-     int bytes_received = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
-                                      (struct sockaddr *)&client_addr, &addr_len);
-        if (bytes_received < 0 || bytes_received > BUFFER_SIZE) {
-            //perror("Failed to receive data");
-            return true;
+    data_source_set_dynamics(
+        DATA_SOURCE(self), &(DynamicsData){
+            .airspeed = self->state.indicated_airspeed,
+            .vertical_speed = self->state.vertical_speed/60,  // it's expecting fps, not fpm
+            .slip_rad = self->state.sideslip
         }
+    );
 
-        buffer[bytes_received] = '\0';
-
-        // Process the DATA* packet
-        if (strncmp(buffer, "DATA*", 5) == 0) {
-            int num_rows = (bytes_received - 5) / 36;  // Each row is 36 bytes
-            for (int i = 0; i < num_rows; ++i) {
-                int row_id;
-                float values[8];
-
-                memcpy(&row_id, buffer + 5 + i * 36, 4);  // Read row ID
-                memcpy(values, buffer + 5 + i * 36 + 4, sizeof(values));  // Read 8 floats
-
-                // Lookup and execute the appropriate parser
-                if (row_id >= 0 && row_id <= 62 && lookup_table[row_id] != NULL) {
-                    lookup_table[row_id](values);
-                } else {
-                    printf("Unsupported row_id: %d\n", row_id);
-                }
-
-            }
-
-            data_source_set_location(
-                DATA_SOURCE(self), &(LocationData){
-                    .super.latitude = position.latitude,
-                    .super.longitude = position.longitude,
-                    .altitude = position.altitude
-                }
-            );
-
-            data_source_set_dynamics(
-                DATA_SOURCE(self), &(DynamicsData){
-                    .airspeed = airspeed.indicated_airspeed,
-                    .vertical_speed = airspeed.vertical/60,  // it's expecting fps, not fpm
-                    .slip_rad = attitude.sideslip
-                }
-            );
-
-            data_source_set_attitude(
-
-                DATA_SOURCE(self), &(AttitudeData){
-                    .roll = attitude.roll,
-                    .pitch = attitude.pitch,
-                    .heading = attitude.heading
-                }
-            );
-
-            data_source_set_engine_data(
-            DATA_SOURCE(self), &(EngineData){
-                .rpm = engine.rpm,
-                .fuel_flow = engine.fuelflow,
-                .oil_temp = engine.oil_temp,
-                .oil_press = engine.oil_press,
-                .cht = engine.cht,
-                .fuel_px = engine.fuel_press,
-                .fuel_qty = engine.fuelQuantity[0] + engine.fuelQuantity[1]
-                }
-            );
-
-            DATA_SOURCE(self)->has_fix = true;
-
-            // printf("Attitude - Pitch: %f, Roll: %f, Heading: %f\n", 
-            //        attitude.pitch, attitude.roll, attitude.heading);
-            // printf("Position - Lat: %f, Lon: %f, Alt: %f\n", 
-            //        position.latitude, position.longitude, position.altitude);
-            // printf("Airspeed - Indicated: %f, True: %f, Ground: %f\n", 
-            //        airspeed.indicated_airspeed, airspeed.true_airspeed, airspeed.groundspeed);
-            // printf("Engine - RPM: %f, OP: %f\n", 
-            //        engine.rpm, engine.oil_press);        
-        
+    data_source_set_attitude(
+        DATA_SOURCE(self), &(AttitudeData){
+            .roll = self->state.roll,
+            .pitch = self->state.pitch,
+            .heading = self->state.heading
+        }
+    );
+
+    data_source_set_engine_data(
+        DATA_SOURCE(self), &(EngineData){
+            .rpm = self->state.rpm,
+            .fuel_flow = self->state.fuel_flow,
+            .oil_temp = self->state.oil_temp,
+            .oil_press = self->state.oil_press,
+            .cht = self->state.cht,
+            .fuel_px = self->state.fuel_press,
+            .fuel_qty = self->state.fuel_qty[0] + self->state.fuel_qty[1],
+            .egt = self->state.egt,
+            .man_press = self->state.man_press,
+            .volts = self->state.battery_volts
         }
+    );
+
+    data_source_set_fix(DATA_SOURCE(self));
 
     return true;
 }
@@ -7,44 +7,49 @@
  */
 #ifndef XP_DATA_SOURCE_H
 #define XP_DATA_SOURCE_H
+#include <netinet/in.h>
 
 #include "data-source.h"
+#include "udp-ingest.h"
 
-// Structs for parsed data
-typedef struct {
-    float pitch, roll, heading,sideslip;  // Attitude (degrees)
-} Attitude;
-
-typedef struct {
-    float latitude, longitude, altitude;  // Position (geographical data)
-} Position;
-
-typedef struct {
-    float indicated_airspeed, true_airspeed, vertical, groundspeed;  // Airspeed (knots)
-} Airspeed;
-
-typedef struct {
-    float rpm;  // Engine data
-    float oil_press;  // Engine data
-    float oil_temp;  // Engine data
-    float egt;  // Engine data
-    float cht;  // Engine data
-    float man_press;  // Engine data
-    float fuelflow;
-    float fuel_press;  // Engine data
-    float fuelQuantity[4];
-    float battery_volts;  // Engine data
-} Engine;
+#define XP_SIM_PORT 49000 /*Port X-Plane listens on for requests*/
 
+/* Everything we know about the sim, in the units of the gauges
+ * (feet, knots, fpm, degrees, °F, PSI, GPH, GAL)*/
+typedef struct{
+    float pitch, roll, heading, sideslip;
+    float latitude, longitude, altitude;
+    float indicated_airspeed, true_airspeed, vertical_speed, groundspeed;
+
+    float rpm;
+    float oil_press;
+    float oil_temp;
+    float egt;
+    float cht;
+    float man_press;
+    float fuel_flow;
+    float fuel_press;
+    float fuel_qty[4];
+    float battery_volts;
+}XPState;
 
 typedef struct{
     DataSource super;
 
-    // FlightgearConnector *fglink;
+    UdpIngest ingest;
     int port;
+
+    XPState state;
+    uint64_t unsupported; /*DATA rows we don't know about*/
+
+    /*RREF subscription, if any*/
+    struct sockaddr_in sim;
+    bool subscribed;
 }XPDataSource;
 
-XPDataSource *xp_data_source_new2(int port);
+XPDataSource *xp_data_source_new(int port);
 XPDataSource *xp_data_source_init(XPDataSource *self, int port);
 
+bool xp_data_source_subscribe(XPDataSource *self, const char *host, int rate);
+void xp_data_source_unsubscribe(XPDataSource *self);
 #endif /* XP_DATA_SOURCE_H */